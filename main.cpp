@@ -1,3 +1,6 @@
+#include <atomic>
+#include <future>
+#include <memory>
 #include <thread>
 #include <signal.h>
 #include <iostream>
@@ -9,42 +12,49 @@
 
 #include "src/led_control.hpp"
 #include "src/utils/utils.hpp"
+#include "src/utils/clock.hpp"
+#include "src/utils/state_file.hpp"
+#include "src/utils/startup_timeline.hpp"
+#include "src/utils/heartbeat_scheduler.hpp"
+#include "src/utils/event_loop.hpp"
 #include "src/network/client.hpp"
+#include "src/network/shm_frame_ring.hpp"
+#include "src/video/frame_source.hpp"
+#include "src/video/debug_renderer.hpp"
+#include "src/video/stall_watchdog.hpp"
+#include "src/video/source_reopener.hpp"
+#include "src/video/frame_pool_allocator.hpp"
 
 // Generated header with information from CMake
 #include "version_config.h"
 
-volatile sig_atomic_t sigInterrupt = 0;
-void sig_handler(int signo) {
-    if (signo == SIGINT) {
-        printf("Received SIGINT...\n");
-        sigInterrupt = 1;
-    }
-    if (signo == SIGTERM) {
-        printf("Received SIGTERM...\n");
-        sigInterrupt = 1;
-    }
-}
-
 int main(int argc, char **argv) {
     // Friendly log to ensure we are using the right version of the code
     printf("******* %s v%s %s *******\n", PROJECT_NAME, PROJECT_VERSION, CMAKE_BUILD_TYPE);
+    teton::utils::StartupTimeline startup;
 
     if (argc < 2) {
         printf("ERROR: Path to video file not provided...\n");
-        printf("  Usage: %s <path_to_video_file>\n", argv[0]);
+        printf("  Usage: %s <path_to_video_file|camera_index|gst:pipeline|v4l2:/dev/videoN|file.y4m|raw:gray:WxH:path|shm:/name|synthetic:WxH>\n", argv[0]);
         return -1;
     }
 
-    // Set up SIGINT/SIGTERM handler for graceful shutdown
-    if (signal(SIGINT, sig_handler) == SIG_ERR)
-        printf("Can't catch SIGINT...\n");
-    if (signal(SIGTERM, sig_handler) == SIG_ERR)
-        printf("Can't catch SIGTERM...\n");
+    // Route SIGINT/SIGTERM through the event loop for graceful shutdown.
+    // This has to happen before any thread is started.
+    teton::utils::SignalFd signals({SIGINT, SIGTERM});
 
     std::string topicLED = "local/signal/led";  // Topic for LED signal
-    int captureWaitTime = 20;  // Interval in seconds that we wait at max to receive a frame from the camera
-    int LEDControlSignalPeriod = 10;  // Interval in seconds that we send the desired LED state
+    std::string topicUpdateLED = "local/update/led";  // Topic on which clients request the current LED signal
+    int captureWaitTime = 20;  // Interval in seconds without frames after which recovery is given up
+    int stallCheckPeriod = 100;  // Interval in milliseconds at which frame gaps are checked
+    int LEDControlSignalPeriod = 10000;  // Interval in milliseconds after which an unchanged LED state is sent again
+    int LEDControlSignalJitter = 1000;  // Spread in milliseconds of that interval across devices
+    int LEDStateMaxAge = 60;  // Age in seconds up to which the LED state from before a restart is published
+    int framePoolSize = 8;  // Number of preallocated frame buffers shared by capture and processing
+#ifdef TETON_DEBUG
+    framePoolSize += 3;  // one per slot of the debug renderer's mailbox
+#endif
+    int frameBusSlots = 4;  // Number of frames kept in the shared memory frame bus
 
     // Query static environment variables
     std::string tetonRoomNoStr;
@@ -52,78 +62,342 @@ int main(int argc, char **argv) {
     teton::utils::getEnvVar("TETON_BED_NO", tetonBedNoStr);
     teton::utils::getEnvVar("TETON_ROOM_NO", tetonRoomNoStr);
 
+    // Frame buffers come from a fixed pool, optionally backed by huge pages.
+    // A reopen attempt hanging at shutdown keeps its own reference.
+    std::string frameHugePagesStr;
+    teton::utils::getEnvVar("TETON_FRAME_HUGEPAGES", frameHugePagesStr);
+    std::shared_ptr<teton::video::FramePoolAllocator> framePool =
+        std::make_shared<teton::video::FramePoolAllocator>(framePoolSize, frameHugePagesStr == "1");
+
+    // Format and size GStreamer pipelines should negotiate, e.g. NV12 and 640x360
+    teton::video::FrameSourceOptions sourceOptions;
+    std::string gstSizeStr;
+    teton::utils::getEnvVar("TETON_GST_FORMAT", sourceOptions.gstFormat);
+    if (teton::utils::getEnvVar("TETON_GST_SIZE", gstSizeStr)) {
+        sscanf(gstSizeStr.c_str(), "%dx%d", &sourceOptions.gstSize.width, &sourceOptions.gstSize.height);
+    }
+
+    // Decoder threading for inputs decoded through FFmpeg
+    std::string decoderThreadsStr;
+    if (teton::utils::getEnvVar("TETON_DECODER_THREADS", decoderThreadsStr)) {
+        sourceOptions.decoder.threads = atoi(decoderThreadsStr.c_str());
+    }
+    teton::utils::getEnvVar("TETON_DECODER_SKIP_FRAME", sourceOptions.decoder.skipFrame);
+    if (!sourceOptions.decoder.valid()) {
+        std::cerr << "Invalid TETON_DECODER_SKIP_FRAME " << sourceOptions.decoder.skipFrame << std::endl;
+        return -1;
+    }
+
+    // OpenCV never passes these on to the decoder, so they are refused rather than ignored
+    std::string unsupportedStr;
+    for (const char *name : {"TETON_DECODER_THREAD_TYPE", "TETON_DECODER_SKIP_IDCT"}) {
+        if (teton::utils::getEnvVar(name, unsupportedStr)) {
+            std::cerr << name << " is not supported, OpenCV does not pass it on to the decoder" << std::endl;
+            return -1;
+        }
+    }
+
+    // Heartbeat spread, so devices started together do not publish in bursts
+    std::string heartbeatJitterStr;
+    if (teton::utils::getEnvVar("TETON_HEARTBEAT_JITTER_MS", heartbeatJitterStr)) {
+        LEDControlSignalJitter = atoi(heartbeatJitterStr.c_str());
+    }
+    // Intervals vary by half the jitter either way, from a whole period on they could get arbitrarily short
+    if (LEDControlSignalJitter < 0 || LEDControlSignalJitter >= LEDControlSignalPeriod) {
+        std::cerr << "TETON_HEARTBEAT_JITTER_MS must be at least 0 and below " << LEDControlSignalPeriod << std::endl;
+        return -1;
+    }
+
+    // Recordings can be replayed in real time or as fast as possible in simulated time
+    std::string replayStr;
+    teton::utils::getEnvVar("TETON_REPLAY", replayStr);
+    if (replayStr == "realtime") {
+        sourceOptions.replay = teton::video::ReplayMode::RealTime;
+    } else if (replayStr == "fast") {
+        sourceOptions.replay = teton::video::ReplayMode::Fast;
+    }
+
+    // Wake-ups for the event loop
+    teton::utils::TimerFd heartbeatTimer;
+    teton::utils::TimerFd stallTimer;
+
     // MQTT client connection setup
     std::string clientId = "FastLEDControl_" + tetonRoomNoStr + "_" + tetonBedNoStr;
-    teton::network::Client client("localhost:1883", clientId);
-    if (!client.connect()) {
-        std::string errorString = "Room " + tetonRoomNoStr + " Bed " + tetonBedNoStr + " Failed to connect to local MQTT master";
-        std::cerr << errorString << std::endl;
-        return -1;
+
+    // Update requests are answered right on Paho's callback thread. It
+    // reads the LED state through an atomic, -1 while there is none, and
+    // has a message template of its own. Both outlive the client.
+    std::atomic<int> currentLEDState(-1);
+    teton::network::PreparedMessage replyMessage(clientId, tetonRoomNoStr, tetonBedNoStr);
+
+    std::string mqttV5Str;
+    teton::utils::getEnvVar("TETON_MQTT_V5", mqttV5Str);
+    teton::network::Client client("localhost:1883", clientId, mqttV5Str == "1" ? MQTTVERSION_5 : MQTTVERSION_3_1_1);
+
+    // The LED state is retained, so new subscribers get it at once. A node
+    // that goes away takes it along: a clean shutdown clears it explicitly,
+    // a crash or a lost connection through the last will. On MQTT v5 it also
+    // expires when no heartbeat refreshed it for three periods, which covers
+    // a node that hangs while its connection stays up.
+    teton::network::TopicPolicy LEDPolicy;
+    LEDPolicy.qos = 1;
+    LEDPolicy.retain = true;
+    LEDPolicy.expirySeconds = 3 * LEDControlSignalPeriod / 1000;
+    LEDPolicy.coalesce = true;
+    std::string LEDBinaryStr;
+    if (teton::utils::getEnvVar("TETON_LED_BINARY", LEDBinaryStr) && LEDBinaryStr == "1") {
+        LEDPolicy.format = teton::network::PayloadFormat::Binary;
+    }
+    client.setTopicPolicy(topicLED, LEDPolicy);
+    client.setLastWill(topicLED, "", LEDPolicy.qos, true);
+
+    // Room, bed and clientId are serialized once for all LED signals
+    teton::network::PreparedMessage LEDMessage(clientId, tetonRoomNoStr, tetonBedNoStr);
+
+    // The latest LED decision survives restarts, by default in the state
+    // directory systemd provides through StateDirectory=, which may list several
+    std::string stateDirectory = std::string("/var/lib/") + PROJECT_NAME;
+    if (teton::utils::getEnvVar("STATE_DIRECTORY", stateDirectory)) {
+        stateDirectory = stateDirectory.substr(0, stateDirectory.find(':'));
+    }
+    std::string stateFilePath = stateDirectory + "/" + clientId + ".state";
+    teton::utils::getEnvVar("TETON_STATE_FILE", stateFilePath);
+    teton::utils::StateFile ledState(stateFilePath);
+    bool restoredLEDState = false;
+    bool haveRestoredLEDState = ledState.open() && ledState.load(restoredLEDState, std::chrono::seconds(LEDStateMaxAge));
+    if (haveRestoredLEDState) {
+        currentLEDState = restoredLEDState ? 1 : 0;
     }
 
+    auto answerUpdateRequest = [&](const mqtt::const_message_ptr &request) {
+        int state = currentLEDState.load();
+        if (state >= 0) {
+            client.reply(request, state == 1, replyMessage, topicLED);
+        }
+    };
+
+    // The broker connection is set up while the input opens and decodes its
+    // first frame, so startup takes the longer of both instead of their sum
+    std::future<bool> connected = std::async(std::launch::async, [&]() {
+        startup.begin("mqtt connect");
+        bool success = client.connect();
+        startup.end("mqtt connect");
+        if (!success) {
+            return false;
+        }
+
+        // A recent state is valid until the first frame was evaluated, so the LEDs get it right away
+        if (haveRestoredLEDState) {
+            client.publish(restoredLEDState, LEDMessage, topicLED);
+            startup.mark("restored publish");
+        }
+
+        startup.begin("mqtt subscribe");
+        if (!client.subscribe(topicUpdateLED, answerUpdateRequest)) {
+            std::cerr << "Failed to subscribe to " << topicUpdateLED << std::endl;
+        }
+        startup.end("mqtt subscribe");
+        return true;
+    });
+
     // Create input stream
-    cv::VideoCapture cap(argv[1]);
+    startup.begin("source open");
+    std::unique_ptr<teton::video::FrameSource> source = teton::video::FrameSource::create(argv[1], sourceOptions, framePool.get());
+    startup.end("source open");
 
-    if (!cap.isOpened()) {
+    if (!source) {
         std::cerr << "Error opening input stream..." << std::endl;
         return -1;
     }
 
-    auto timeOfLastCapture = std::chrono::high_resolution_clock::now();
-    auto timeOfLastLEDControlSignalSent = std::chrono::high_resolution_clock::now();
+    // Capture threads already decode the first frame while we wait
+    if (!connected.get()) {
+        std::string errorString = "Room " + tetonRoomNoStr + " Bed " + tetonBedNoStr + " Failed to connect to local MQTT master";
+        std::cerr << errorString << std::endl;
+        return -1;
+    }
 
-    // Do inference until node is stopped
-    while (!sigInterrupt) {
-        // Capture a new frame
-        cv::Mat frame;
-        cap >> frame;
-
-        // If we have not captured a frame for 20 seconds, something is really wrong
-        if (frame.empty()) {
-            auto timeSinceLastCapture = std::chrono::duration_cast<std::chrono::seconds>(
-                std::chrono::high_resolution_clock::now() - timeOfLastCapture
-            );
-            if (timeSinceLastCapture.count() > captureWaitTime) {
-                printf("Camera is not streaming...\n");
-                sigInterrupt = 1;
-            }
+    // Stalled live inputs are reopened in the background, recordings simply end
+    teton::video::StallWatchdog watchdog(source->fps(), std::chrono::seconds(captureWaitTime), source->live());
+    teton::video::SourceReopener reopener;
 
-            // Sleep for 10 milliseconds
-            boost::this_thread::sleep(boost::posix_time::milliseconds(10));
-            continue;
+    // Optionally share every decoded frame with other local vision nodes
+    std::string frameBusName;
+    std::unique_ptr<teton::network::ShmFrameRingWriter> frameBus;
+    if (teton::utils::getEnvVar("TETON_SHM_OUT", frameBusName)) {
+        frameBus.reset(new teton::network::ShmFrameRingWriter(frameBusName, frameBusSlots));
+    }
+
+    // In fast replays every frame advances a virtual clock by one frame period
+    teton::utils::Clock clock(sourceOptions.replay == teton::video::ReplayMode::Fast);
+    double replayFps = source->fps() > 0.0 ? source->fps() : 30.0;
+    long long frameIndex = 0;
+
+    bool haveDecision = false;
+    bool haveLEDState = haveRestoredLEDState;
+    bool turnLEDsOn = restoredLEDState;
+    teton::utils::HeartbeatScheduler heartbeat(std::chrono::milliseconds(LEDControlSignalPeriod),
+                                               std::chrono::milliseconds(LEDControlSignalJitter), clientId);
+
+    teton::utils::EventLoop loop;
+
+#ifdef TETON_DEBUG
+    // Closing the debug window with ESC stops the node
+    teton::video::DebugRenderer debugRenderer(framePool.get());
+    loop.add(debugRenderer.closedFd(), [&]() {
+        loop.stop();
+    });
+#endif
+
+    loop.add(signals.fd(), [&]() {
+        int signo = signals.read();
+        if (signo == SIGINT) {
+            printf("Received SIGINT...\n");
+        }
+        if (signo == SIGTERM) {
+            printf("Received SIGTERM...\n");
         }
+        loop.stop();
+    });
 
-        timeOfLastCapture = std::chrono::high_resolution_clock::now();
+    // Send signal to turn LEDs on/off. Any publish restarts the heartbeat period.
+    auto sendLEDControlSignal = [&]() {
+        if (haveLEDState) {
+            client.publish(turnLEDsOn, LEDMessage, topicLED);
+        }
+        heartbeat.reset(clock.now());
+        if (!clock.simulated()) {
+            heartbeatTimer.arm(heartbeat.remaining(clock.now()), std::chrono::nanoseconds::zero());
+        }
+    };
 
-        // Determine whether we should turn the LEDs on or off
-        bool turnLEDsOn = teton::computeLEDSignalFromImageBrightness(frame);
+    auto evaluateFrame = [&](cv::Mat &frame) {
+        watchdog.frameArrived(std::chrono::steady_clock::now());
 
-        // Send signal to turn LEDs on/off
-        auto timeSinceLastLEDControlSignalSent = std::chrono::duration_cast<std::chrono::seconds>(
-            std::chrono::high_resolution_clock::now() - timeOfLastLEDControlSignalSent
-        );
-        if (timeSinceLastLEDControlSignalSent.count() > LEDControlSignalPeriod) {
-            timeOfLastLEDControlSignalSent = std::chrono::high_resolution_clock::now();
-            client.publish(turnLEDsOn, clientId, tetonRoomNoStr, tetonBedNoStr, topicLED);
+        // Determine whether we should turn the LEDs on or off. Shared frames
+        // overwritten while we looked at them are discarded.
+        bool decision = teton::computeLEDSignalFromImageBrightness(frame);
+        if (!source->intact()) {
+            return;
         }
+        if (!haveDecision) {
+            startup.mark("first decision");
+            startup.print();
+        }
+        // The state file holds the latest decision, stored exactly once per
+        // evaluated frame, whether or not its publish reached the broker yet.
+        // Its age thus tells how long ago the camera last confirmed it.
+        ledState.store(decision);
+        bool changed = !haveLEDState || decision != turnLEDsOn;
+        turnLEDsOn = decision;
+        currentLEDState = decision ? 1 : 0;
+        haveLEDState = true;
+        haveDecision = true;
 
-#ifdef TETON_DEBUG
-        std::string ledText = std::string("LED: ") + (turnLEDsOn ? "ON" : "OFF");
-        cv::putText(frame, ledText, cv::Point(80, 100), cv::FONT_HERSHEY_COMPLEX, 2, cv::Scalar(255, 255, 255), 3);
+        if (frameBus) {
+            frameBus->write(frame);
+        }
 
-        cv::Mat downScaled;
-        cv::resize(frame, downScaled, cv::Size(960, 720), cv::INTER_LINEAR);
+        // Simulated time has no timer, the heartbeat is checked after every frame
+        if (clock.simulated()) {
+            frameIndex++;
+            clock.advance(std::chrono::duration_cast<teton::utils::Clock::duration>(
+                std::chrono::duration<double>(frameIndex / replayFps)));
+        }
 
-        cv::imshow("Debug Visualization", downScaled);
-        int keycode = cv::waitKey(1) & 0xff;
-        if (keycode == 27) {
-            sigInterrupt = 1;
-            break;
+        // Changes go out right away, unchanged states with the heartbeat
+        if (changed || (clock.simulated() && heartbeat.due(clock.now()))) {
+            sendLEDControlSignal();
         }
+
+#ifdef TETON_DEBUG
+        debugRenderer.submit(frame, turnLEDsOn);
 #endif
+    };
+
+    // Frames are handed back to the source as soon as they were evaluated.
+    // A recording that ended stops the node, a live source that ended stops
+    // being polled and the watchdog takes over.
+    auto frameReady = [&]() {
+        cv::Mat frame;
+        if (source->read(frame)) {
+            evaluateFrame(frame);
+            source->release();
+        } else if (source->ended()) {
+            loop.remove(source->fd());
+            if (!source->live()) {
+                printf("End of recording...\n");
+                loop.stop();
+            }
+        }
+    };
+    loop.add(source->fd(), frameReady);
+
+    loop.add(heartbeatTimer.fd(), [&]() {
+        heartbeatTimer.drain();
+        sendLEDControlSignal();
+    });
+
+    // Missed frames are recovered in tiers while the last LED state keeps
+    // being published. Only when reopening and a backend reset both failed
+    // for 20 seconds, something is really wrong.
+    loop.add(stallTimer.fd(), [&]() {
+        stallTimer.drain();
+        auto now = std::chrono::steady_clock::now();
+        if (watchdog.expired(now)) {
+            printf("Camera is not streaming...\n");
+            loop.stop();
+            return;
+        }
+        if (reopener.busy()) {
+            return;
+        }
+
+        teton::video::Recovery recovery = watchdog.escalate(now);
+        if (recovery == teton::video::Recovery::None) {
+            return;
+        }
+
+        // A backend reset drops the decoder tuning. The configured pipeline
+        // caps stay, so frames keep the geometry everything downstream expects.
+        teton::video::FrameSourceOptions options = sourceOptions;
+        if (recovery == teton::video::Recovery::ResetBackend) {
+            options.decoder = teton::video::DecoderOptions();
+        }
+
+        long long gapMs = std::chrono::duration_cast<std::chrono::milliseconds>(watchdog.gap(now)).count();
+        printf("No frame for %lld ms, %s input (attempt %d)...\n", gapMs,
+               recovery == teton::video::Recovery::Reopen ? "reopening" : "resetting", watchdog.attempts());
+        if (source) {
+            loop.remove(source->fd());
+        }
+        reopener.start(std::move(source), argv[1], options, framePool);
+    });
+
+    loop.add(reopener.fd(), [&]() {
+        source = reopener.take();
+        watchdog.recoveryFinished(std::chrono::steady_clock::now());
+        if (!source) {
+            std::cerr << "Error reopening input stream..." << std::endl;
+            return;
+        }
+        loop.add(source->fd(), frameReady);
+    });
+
+    if (!clock.simulated()) {
+        heartbeatTimer.arm(heartbeat.remaining(clock.now()), std::chrono::nanoseconds::zero());
     }
+    stallTimer.arm(std::chrono::milliseconds(stallCheckPeriod), std::chrono::milliseconds(stallCheckPeriod));
+
+    // Do inference until node is stopped
+    loop.run();
 
     // Clean up
+    source.reset();
+#ifdef TETON_BENCHMARK
+    printf("Frame allocations outside the pool: %zu\n", framePool->fallbacks());
+#endif
+    client.clearRetained(topicLED);
     client.disconnect();
 
     return 0;
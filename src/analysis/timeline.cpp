@@ -0,0 +1,105 @@
+#include "timeline.hpp"
+
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <opencv2/core.hpp>
+
+#include "../led_control.hpp"
+#include "../video/video_capture_source.hpp"
+
+namespace teton {
+namespace analysis {
+
+static TimelineSample evaluate(const cv::Mat &frame, double seconds) {
+    TimelineSample sample;
+    sample.seconds = seconds;
+    sample.brightness = cv::mean(frame)[0];
+    sample.led = computeLEDSignalFromImageBrightness(frame);
+    return sample;
+}
+
+video::DecoderOptions decoderOptions(const TimelineOptions &options) {
+    // Keyframes decode on their own, so the decoder can drop everything else.
+    // This goes to FFmpeg as OpenCV's avdiscard option.
+    video::DecoderOptions decoder;
+    decoder.threads = options.decoderThreads;
+    if (options.mode == SampleMode::Keyframes) {
+        decoder.skipFrame = "nonkey";
+    }
+    return decoder;
+}
+
+bool analyzeRecording(const std::string &path, const TimelineOptions &options, std::vector<TimelineSample> &timeline) {
+    video::VideoCaptureSource source(path, decoderOptions(options));
+    if (!source.open()) {
+        fprintf(stderr, "Error opening %s\n", path.c_str());
+        return false;
+    }
+
+    cv::Mat frame;
+    if (options.mode == SampleMode::All || options.mode == SampleMode::Keyframes) {
+        while (source.read(frame)) {
+            timeline.push_back(evaluate(frame, source.position()));
+        }
+        return true;
+    }
+
+    // Each seek lands on the preceding keyframe and decodes forward from there.
+    // Near the end a seek can succeed and still leave the position where it
+    // was, so sampling stops once the position no longer advances.
+    double last = -1.0;
+    for (double seconds = 0.0; source.seek(seconds) && source.read(frame); seconds += options.strideSeconds) {
+        double position = source.position();
+        if (position <= last) {
+            break;
+        }
+        last = position;
+        timeline.push_back(evaluate(frame, position));
+    }
+    return true;
+}
+
+void writeTimelineCsv(std::ostream &out, const std::vector<TimelineSample> &timeline) {
+    char line[64];
+    out << "seconds,brightness,led\n";
+    for (const auto &sample : timeline) {
+        snprintf(line, sizeof(line), "%.3f,%.2f,%d\n", sample.seconds, sample.brightness, sample.led ? 1 : 0);
+        out << line;
+    }
+}
+
+// Stores the low `bytes` bytes of value least significant first, whatever
+// the byte order of the host
+static void putLittleEndian(char *out, uint64_t value, size_t bytes) {
+    for (size_t i = 0; i < bytes; i++) {
+        out[i] = static_cast<char>((value >> (8 * i)) & 0xff);
+    }
+}
+
+void writeTimelineBinary(std::ostream &out, const std::vector<TimelineSample> &timeline) {
+    const uint32_t version = 1;
+    char header[12];
+    memcpy(header, "TLTL", 4);
+    putLittleEndian(header + 4, version, sizeof(uint32_t));
+    putLittleEndian(header + 8, static_cast<uint32_t>(timeline.size()), sizeof(uint32_t));
+    out.write(header, sizeof(header));
+
+    char record[16];
+    for (const auto &sample : timeline) {
+        uint64_t seconds;
+        uint32_t brightness;
+        float brightnessFloat = static_cast<float>(sample.brightness);
+        memcpy(&seconds, &sample.seconds, sizeof(seconds));
+        memcpy(&brightness, &brightnessFloat, sizeof(brightness));
+
+        memset(record, 0, sizeof(record));
+        putLittleEndian(record, seconds, sizeof(seconds));
+        putLittleEndian(record + 8, brightness, sizeof(brightness));
+        record[12] = sample.led ? 1 : 0;
+        out.write(record, sizeof(record));
+    }
+}
+
+}  // namespace analysis
+}  // namespace teton
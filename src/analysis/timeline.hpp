@@ -0,0 +1,48 @@
+#ifndef __TETON_ANALYSIS_TIMELINE_HPP__
+#define __TETON_ANALYSIS_TIMELINE_HPP__
+
+#include <string>
+#include <vector>
+#include <ostream>
+
+#include "../video/frame_source.hpp"
+
+namespace teton {
+namespace analysis {
+
+// Which frames of a recording are evaluated
+enum class SampleMode {
+    All,        // every frame, decoded sequentially
+    Keyframes,  // only keyframes, everything else is skipped by the decoder
+    Stride,     // one frame every strideSeconds, reached by seeking
+};
+
+struct TimelineOptions {
+    SampleMode mode = SampleMode::Stride;
+    double strideSeconds = 1.0;
+    int decoderThreads = 0;  // 0 lets FFmpeg pick, batch runs use 1 per worker
+};
+
+struct TimelineSample {
+    double seconds;     // position in the recording
+    double brightness;  // mean intensity of the first channel
+    bool led;           // decision of computeLEDSignalFromImageBrightness
+};
+
+// Decoder settings analyzeRecording() opens recordings with
+video::DecoderOptions decoderOptions(const TimelineOptions &options);
+
+// Evaluates a sparse subset of a recording instead of decoding every frame
+bool analyzeRecording(const std::string &path, const TimelineOptions &options, std::vector<TimelineSample> &timeline);
+
+void writeTimelineCsv(std::ostream &out, const std::vector<TimelineSample> &timeline);
+
+// Little-endian "TLTL" magic, uint32 version and sample count, then one
+// 16 byte record per sample: float64 seconds, float32 brightness, uint8 led
+// and 3 bytes of padding
+void writeTimelineBinary(std::ostream &out, const std::vector<TimelineSample> &timeline);
+
+}  // namespace analysis
+}  // namespace teton
+
+#endif
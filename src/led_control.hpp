@@ -6,7 +6,7 @@
 namespace teton {
 
 // TODO: Implement this function. Make it as fast as possible.
-bool computeLEDSignalFromImageBrightness(const cv::Mat &image) {
+inline bool computeLEDSignalFromImageBrightness(const cv::Mat &image) {
     return false;
 }
 
@@ -0,0 +1,40 @@
+#include "binary_payload.hpp"
+
+#include <cstdlib>
+#include <cstring>
+
+#if __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "Binary payloads are written in host byte order, which must be little-endian"
+#endif
+
+namespace teton {
+namespace network {
+
+uint16_t binaryId(const std::string &id) {
+    char *end = nullptr;
+    unsigned long value = strtoul(id.c_str(), &end, 10);
+    if (id.empty() || *end != '\0' || value >= BINARY_UNKNOWN_ID) {
+        return BINARY_UNKNOWN_ID;
+    }
+    return static_cast<uint16_t>(value);
+}
+
+std::string binaryIdString(uint16_t id) {
+    return id == BINARY_UNKNOWN_ID ? std::string() : std::to_string(id);
+}
+
+void encodeBinaryPayload(const BinaryPayloadHeader &header, const char *text, size_t textLength, std::string &out) {
+    out.assign(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.append(text, textLength);
+}
+
+bool decodeBinaryPayload(const std::string &payload, BinaryPayloadHeader &header) {
+    if (payload.size() < sizeof(header) || payload[0] != static_cast<char>(BINARY_PAYLOAD_VERSION)) {
+        return false;
+    }
+    memcpy(&header, payload.data(), sizeof(header));
+    return true;
+}
+
+}  // namespace network
+}  // namespace teton
@@ -0,0 +1,48 @@
+#ifndef __TETON_NETWORK_BINARY_PAYLOAD_HPP__
+#define __TETON_NETWORK_BINARY_PAYLOAD_HPP__
+
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+namespace teton {
+namespace network {
+
+const uint8_t BINARY_PAYLOAD_VERSION = 1;
+
+const uint8_t BINARY_FLAG_BOOL = 0x01;    // value holds the data
+const uint8_t BINARY_FLAG_STRING = 0x02;  // UTF-8 data follows the header
+
+// Room or bed that is not a number below 65535
+const uint16_t BINARY_UNKNOWN_ID = 0xffff;
+
+// Fixed layout of binary payloads, little-endian. Compared to the JSON form
+// it is 24 instead of ~120 bytes, and reading it takes a size check and a
+// copy instead of a DOM parse. Its first byte is never '{', so readers tell
+// both apart without knowing the topic's format.
+struct BinaryPayloadHeader {
+    uint8_t version;      // BINARY_PAYLOAD_VERSION
+    uint8_t flags;        // BINARY_FLAG_*
+    uint8_t value;        // bool or level
+    uint8_t reserved;
+    uint16_t room;
+    uint16_t bed;
+    uint64_t sequence;    // per publishing client, from 1 after each start
+    int64_t timestampNs;  // since the Unix epoch
+};
+
+static_assert(sizeof(BinaryPayloadHeader) == 24, "BinaryPayloadHeader is part of the wire format");
+
+uint16_t binaryId(const std::string &id);
+std::string binaryIdString(uint16_t id);
+
+// Replaces out with the header followed by the text
+void encodeBinaryPayload(const BinaryPayloadHeader &header, const char *text, size_t textLength, std::string &out);
+
+// False for JSON payloads and truncated or unknown binary ones
+bool decodeBinaryPayload(const std::string &payload, BinaryPayloadHeader &header);
+
+}  // namespace network
+}  // namespace teton
+
+#endif
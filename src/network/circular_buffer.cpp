@@ -3,8 +3,6 @@
 namespace teton {
 namespace network {
 
-using namespace cv;
-
 template <class T>
 CircularBuffer<T>::CircularBuffer(size_t size) :
     buf_(std::unique_ptr<T[]>(new T[size])),
@@ -76,7 +74,6 @@ T CircularBuffer<T>::get() {
     return val;
 }
 
-template class CircularBuffer<Mat>;
 template class CircularBuffer<mqtt::const_message_ptr>;
 
 }  // namespace network
@@ -4,7 +4,6 @@
 #include <cstdio>
 #include <memory>
 #include <mutex>
-#include <opencv2/core.hpp>
 
 #include "mqtt/async_client.h"
 
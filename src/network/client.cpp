@@ -4,18 +4,72 @@ namespace teton {
 namespace network {
 
 const auto TIMEOUT = std::chrono::seconds(5);
-const int QOS = 2;
-const std::string NODE_END = "node_end";
+const size_t MAX_IN_FLIGHT = 8;
+const size_t MAX_QUEUED = 64;
 const std::string CLIENT_LOG = "[teton::network::Client]   ";
 
-Client::Client(std::string host, std::string clientId) :
-    _client(host, clientId) {
+// Shared by the client and its listeners. Paho may still report tokens
+// that were pending when a flush timed out after the client is gone.
+struct Client::Owner {
+    std::mutex mutex;
+    Client *client;
+};
+
+// Reports the outcome of one queued message, deletes itself afterwards
+class Client::DeliveryListener : public mqtt::iaction_listener {
+   public:
+    DeliveryListener(std::shared_ptr<Owner> owner, std::string topic) :
+        mOwner(owner),
+        mTopic(topic) {
+        // empty constructor
+    }
+
+    void on_success(const mqtt::token &) override {
+        report(true);
+    }
+
+    void on_failure(const mqtt::token &) override {
+        report(false);
+    }
+
+   private:
+    std::shared_ptr<Owner> mOwner;
+    std::string mTopic;
+
+    // The client waits for a running report before it is destroyed
+    void report(bool success) {
+        {
+            const std::lock_guard<std::mutex> lock(mOwner->mutex);
+            if (mOwner->client != nullptr) {
+                mOwner->client->delivered(mTopic, success);
+            }
+        }
+        delete this;
+    }
+};
+
+Client::Client(std::string host, std::string clientId, int mqttVersion) :
+    mOwner(std::make_shared<Owner>()),
+    _client(host, clientId, mqtt::create_options(mqttVersion)) {
+    mOwner->client = this;
     mClientId = clientId;
-    mRunning = false;
+    mMqttVersion = mqttVersion;
+    mBootMs = utils::epochNs() / 1000000;
+    mSequence = 0;
+    mInFlight = 0;
+
+    // Messages are dispatched as they arrive, there is no consuming thread
+    _client.set_message_callback([this](mqtt::const_message_ptr msg) {
+        messageArrived(msg);
+    });
 }
 
 Client::~Client() {
     disconnect();
+
+    // Listeners of messages that were never acknowledged stop reporting here
+    const std::lock_guard<std::mutex> lock(mOwner->mutex);
+    mOwner->client = nullptr;
 }
 
 bool Client::connect() {
@@ -24,19 +78,21 @@ bool Client::connect() {
         return true;
     }
 
-    // Connect to the master
-    if (_client.connect()->wait_for(20000)) {
+    // Connect to the master. MQTT v5 replaced clean sessions with clean starts.
+    mqtt::connect_options options;
+    options.set_mqtt_version(mMqttVersion);
+    if (mMqttVersion >= MQTTVERSION_5) {
+        options.set_clean_start(true);
+    }
+    if (mWill) {
+        options.set_will(*mWill);
+    }
+    if (_client.connect(options)->wait_for(20000)) {
         if (!_client.is_connected()) {
             std::cerr << CLIENT_LOG << "Could not connect to MQTT master." << std::endl;
             return false;
         }
 
-        // If we connected successfully, subscribe to the special topic
-        if (!subscribe(NODE_END)) {
-            std::cerr << CLIENT_LOG << "Could not subscribe to special NODE_END topic." << std::endl;
-            return false;
-        }
-
         std::cout << CLIENT_LOG << "Successfully connected to MQTT master." << std::endl;
         return true;
     }
@@ -48,22 +104,9 @@ bool Client::connect() {
 bool Client::disconnect() {
     std::cout << CLIENT_LOG << "Client is disconnecting..." << std::endl;
 
-    // Stop the threads
-    if (mRunning.load()) {
-        if (_client.is_connected()) {
-            publish(mClientId.c_str(), NODE_END);
-        }
-    }
-
-    // Wait for the threads to exit
-    while (mRunning.load()) {
-        std::this_thread::sleep_for(std::chrono::milliseconds(5));
-    }
-
-    for (auto &t : mThreads) {
-        if (t.joinable()) {
-            t.join();
-        }
+    // Hand the last states to the broker before the connection goes away
+    if (!flush(std::chrono::duration_cast<std::chrono::milliseconds>(TIMEOUT))) {
+        std::cerr << CLIENT_LOG << "Timed out waiting for queued messages." << std::endl;
     }
 
     // Disconnect the client
@@ -94,15 +137,33 @@ bool Client::subscribe(std::vector<std::string> topic) {
 bool Client::subscribe(const std::string topic) {
     // std::cout << CLIENT_LOG << "Subscribing to topic: " << topic << std::endl;
 
-    // Check if this is the first topic we're subscibing to. If so, start
-    // the consuming thread.
-    if (pendingSubscriptions.size() == 0) {
-        mThreads.push_back(std::thread(&Client::start, this));
+    // Set up before subscribing, retained messages arrive right away
+    {
+        const std::lock_guard<std::mutex> lock(mMutexBuffer);
+        if (pendingSubscriptions.find(topic) == pendingSubscriptions.end()) {
+            pendingSubscriptions[topic] = new CircularBuffer<mqtt::const_message_ptr>(5);
+        }
+    }
+
+    if (_client.is_connected()) {
+        if (_client.subscribe(topic, 0)->wait_for(2000)) {
+            std::cout << CLIENT_LOG << "Subscribed to topic: " << topic << std::endl;
+            return true;
+        }
+    }
+
+    std::cerr << CLIENT_LOG << "Client is not connected. Failed to subscribe to topic: " << topic << std::endl;
+    return false;
+}
+
+bool Client::subscribe(const std::string topic, MessageHandler handler) {
+    {
+        const std::lock_guard<std::mutex> lock(mMutexBuffer);
+        mHandlers[topic] = handler;
     }
 
     if (_client.is_connected()) {
         if (_client.subscribe(topic, 0)->wait_for(2000)) {
-            pendingSubscriptions[topic] = new CircularBuffer<mqtt::const_message_ptr>(5);
             std::cout << CLIENT_LOG << "Subscribed to topic: " << topic << std::endl;
             return true;
         }
@@ -116,35 +177,75 @@ bool Client::isConnected() {
     return _client.is_connected();
 }
 
+void Client::setDeliveryCallback(std::function<void(const std::string &, bool)> callback) {
+    const std::lock_guard<std::mutex> lock(mMutexPublish);
+    mDeliveryCallback = callback;
+}
+
+void Client::setLastWill(const std::string topic, const std::string payload, int qos, bool retain) {
+    mWill.reset(new mqtt::will_options(topic, payload, qos, retain));
+}
+
+bool Client::clearRetained(const std::string topic) {
+    return enqueue(topic, [](uint64_t) {
+        return std::make_shared<const std::string>();
+    });
+}
+
+void Client::setTopicPolicy(const std::string topic, const TopicPolicy &policy) {
+    const std::lock_guard<std::mutex> lock(mMutexPublish);
+    mTopicPolicies[topic] = policy;
+}
+
+bool Client::flush(std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> lock(mMutexPublish);
+    return mDelivered.wait_for(lock, timeout, [this]() { return mQueue.empty() && mInFlight == 0; });
+}
+
 bool Client::publish(bool signal, std::string clientid, std::string room, std::string bed, std::string topic) {
-    // create json object
-    rapidjson::Document d;
-    d.SetObject();
-    rapidjson::Document::AllocatorType &allocator = d.GetAllocator();
-    size_t sz = allocator.Size();
-
-    std::string timestamp = getTimestamp();
-
-    // Adding content to json
-    rapidjson::Value clientVal, timestampVal, dataVal, roomVal, bedVal;
-    dataVal.SetBool(signal);
-    roomVal.SetString(room.c_str(), room.length(), allocator);
-    bedVal.SetString(bed.c_str(), bed.length(), allocator);
-    timestampVal.SetString(timestamp.c_str(), timestamp.length(), allocator);
-    clientVal.SetString(clientid.c_str(), clientid.length(), allocator);
-
-    d.AddMember("data", dataVal, allocator);
-    d.AddMember("room", roomVal, allocator);
-    d.AddMember("bed", bedVal, allocator);
-    d.AddMember("timestamp", timestampVal, allocator);
-    d.AddMember("clientId", clientVal, allocator);
-
-    // write json to string
-    rapidjson::StringBuffer strBuffer;
-    rapidjson::Writer<rapidjson::StringBuffer> writer(strBuffer);
-    d.Accept(writer);
-    const char *output = strBuffer.GetString();
-    if (!publish(output, topic)) {
+    if (policyFor(topic).format == PayloadFormat::Binary) {
+        return publishBinary(BINARY_FLAG_BOOL, signal ? 1 : 0, room, bed, std::string(), topic);
+    }
+
+    int64_t timestampNs = utils::epochNs();
+    char timestamp[utils::TIMESTAMP_LENGTH + 1];
+    getTimestamp(timestamp, timestampNs);
+
+    // The document is built once the queue assigned the sequence number
+    bool queued = enqueue(topic, [&](uint64_t sequence) {
+        // create json object
+        rapidjson::Document d;
+        d.SetObject();
+        rapidjson::Document::AllocatorType &allocator = d.GetAllocator();
+        size_t sz = allocator.Size();
+
+        // Adding content to json
+        rapidjson::Value clientVal, timestampVal, dataVal, roomVal, bedVal, timestampNsVal, bootMsVal, sequenceVal;
+        dataVal.SetBool(signal);
+        roomVal.SetString(room.c_str(), room.length(), allocator);
+        bedVal.SetString(bed.c_str(), bed.length(), allocator);
+        timestampVal.SetString(timestamp, utils::TIMESTAMP_LENGTH, allocator);
+        clientVal.SetString(clientid.c_str(), clientid.length(), allocator);
+        timestampNsVal.SetInt64(timestampNs);
+        bootMsVal.SetInt64(mBootMs);
+        sequenceVal.SetUint64(sequence);
+
+        d.AddMember("data", dataVal, allocator);
+        d.AddMember("room", roomVal, allocator);
+        d.AddMember("bed", bedVal, allocator);
+        d.AddMember("timestamp", timestampVal, allocator);
+        d.AddMember("clientId", clientVal, allocator);
+        d.AddMember("timestampNs", timestampNsVal, allocator);
+        d.AddMember("bootMs", bootMsVal, allocator);
+        d.AddMember("sequence", sequenceVal, allocator);
+
+        // write json to string
+        rapidjson::StringBuffer strBuffer;
+        rapidjson::Writer<rapidjson::StringBuffer> writer(strBuffer);
+        d.Accept(writer);
+        return std::make_shared<const std::string>(strBuffer.GetString(), strBuffer.GetSize());
+    });
+    if (!queued) {
         std::cerr << CLIENT_LOG << "Failed to log signal to " << topic << std::endl;
         return false;
     }
@@ -153,34 +254,49 @@ bool Client::publish(bool signal, std::string clientid, std::string room, std::s
 }
 
 bool Client::publish(std::string signal, std::string clientid, std::string room, std::string bed, std::string topic) {
-    // create json object
-    rapidjson::Document d;
-    d.SetObject();
-    rapidjson::Document::AllocatorType &allocator = d.GetAllocator();
-    size_t sz = allocator.Size();
-
-    std::string timestamp = getTimestamp();
-
-    // Adding content to json
-    rapidjson::Value clientVal, timestampVal, dataVal, roomVal, bedVal;
-    dataVal.SetString(signal.c_str(), signal.length(), allocator);
-    roomVal.SetString(room.c_str(), room.length(), allocator);
-    bedVal.SetString(bed.c_str(), bed.length(), allocator);
-    timestampVal.SetString(timestamp.c_str(), timestamp.length(), allocator);
-    clientVal.SetString(clientid.c_str(), clientid.length(), allocator);
-
-    d.AddMember("data", dataVal, allocator);
-    d.AddMember("room", roomVal, allocator);
-    d.AddMember("bed", bedVal, allocator);
-    d.AddMember("timestamp", timestampVal, allocator);
-    d.AddMember("clientId", clientVal, allocator);
-
-    // write json to string
-    rapidjson::StringBuffer strBuffer;
-    rapidjson::Writer<rapidjson::StringBuffer> writer(strBuffer);
-    d.Accept(writer);
-    const char *output = strBuffer.GetString();
-    if (!publish(output, topic)) {
+    if (policyFor(topic).format == PayloadFormat::Binary) {
+        return publishBinary(BINARY_FLAG_STRING, 0, room, bed, signal, topic);
+    }
+
+    int64_t timestampNs = utils::epochNs();
+    char timestamp[utils::TIMESTAMP_LENGTH + 1];
+    getTimestamp(timestamp, timestampNs);
+
+    // The document is built once the queue assigned the sequence number
+    bool queued = enqueue(topic, [&](uint64_t sequence) {
+        // create json object
+        rapidjson::Document d;
+        d.SetObject();
+        rapidjson::Document::AllocatorType &allocator = d.GetAllocator();
+        size_t sz = allocator.Size();
+
+        // Adding content to json
+        rapidjson::Value clientVal, timestampVal, dataVal, roomVal, bedVal, timestampNsVal, bootMsVal, sequenceVal;
+        dataVal.SetString(signal.c_str(), signal.length(), allocator);
+        roomVal.SetString(room.c_str(), room.length(), allocator);
+        bedVal.SetString(bed.c_str(), bed.length(), allocator);
+        timestampVal.SetString(timestamp, utils::TIMESTAMP_LENGTH, allocator);
+        clientVal.SetString(clientid.c_str(), clientid.length(), allocator);
+        timestampNsVal.SetInt64(timestampNs);
+        bootMsVal.SetInt64(mBootMs);
+        sequenceVal.SetUint64(sequence);
+
+        d.AddMember("data", dataVal, allocator);
+        d.AddMember("room", roomVal, allocator);
+        d.AddMember("bed", bedVal, allocator);
+        d.AddMember("timestamp", timestampVal, allocator);
+        d.AddMember("clientId", clientVal, allocator);
+        d.AddMember("timestampNs", timestampNsVal, allocator);
+        d.AddMember("bootMs", bootMsVal, allocator);
+        d.AddMember("sequence", sequenceVal, allocator);
+
+        // write json to string
+        rapidjson::StringBuffer strBuffer;
+        rapidjson::Writer<rapidjson::StringBuffer> writer(strBuffer);
+        d.Accept(writer);
+        return std::make_shared<const std::string>(strBuffer.GetString(), strBuffer.GetSize());
+    });
+    if (!queued) {
         std::cerr << CLIENT_LOG << "Failed to log signal to " << topic << std::endl;
         return false;
     }
@@ -192,14 +308,70 @@ bool Client::publish(const char *signal, std::string clientid, std::string room,
     return publish(std::string(signal), clientid, room, bed, topic);
 }
 
-std::tuple<bool, std::string, std::string, bool, std::string, std::string> Client::getBool(const std::string topic) {
+bool Client::publish(bool signal, PreparedMessage &message, std::string topic) {
+    return publish(signal, message, topic, std::string());
+}
+
+bool Client::reply(const mqtt::const_message_ptr &request, bool signal, PreparedMessage &message, std::string topic) {
+    std::string correlation;
+    if (mMqttVersion >= MQTTVERSION_5) {
+        const mqtt::properties &properties = request->get_properties();
+        if (properties.contains(mqtt::property::RESPONSE_TOPIC)) {
+            topic = mqtt::get<std::string>(properties, mqtt::property::RESPONSE_TOPIC);
+        }
+        if (properties.contains(mqtt::property::CORRELATION_DATA)) {
+            correlation = mqtt::get<std::string>(properties, mqtt::property::CORRELATION_DATA);
+        }
+    }
+
+    return publish(signal, message, topic, correlation);
+}
+
+bool Client::publish(bool signal, PreparedMessage &message, const std::string &topic, const std::string &correlation) {
+    int64_t timestampNs = utils::epochNs();
+    bool queued;
+    if (policyFor(topic).format == PayloadFormat::Binary) {
+        queued = enqueue(topic, [&](uint64_t sequence) {
+            return message.formatBinary(signal, timestampNs, sequence);
+        }, correlation);
+    } else {
+        char timestamp[utils::TIMESTAMP_LENGTH + 1];
+        getTimestamp(timestamp, timestampNs);
+        queued = enqueue(topic, [&](uint64_t sequence) {
+            return message.format(signal, timestamp, timestampNs, mBootMs, sequence);
+        }, correlation);
+    }
+
+    if (!queued) {
+        std::cerr << CLIENT_LOG << "Failed to log signal to " << topic << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+std::tuple<bool, std::string, std::string, bool, std::string, std::string, uint64_t, int64_t> Client::getBool(const std::string topic) {
     auto buffer = getBuffer(topic);
     if (!buffer->empty()) {
         mqtt::const_message_ptr msg_ptr = buffer->get();
+
+        // Binary payloads carry no clientId
+        BinaryPayloadHeader header;
+        if (decodeBinaryPayload(msg_ptr->get_payload_str(), header)) {
+            if (header.flags & BINARY_FLAG_BOOL) {
+                char timestamp[utils::TIMESTAMP_LENGTH + 1];
+                utils::formatTimestamp(timestamp, header.timestampNs);
+                return make_tuple(true, binaryIdString(header.room), binaryIdString(header.bed), header.value != 0,
+                                  std::string(), std::string(timestamp), header.sequence, header.timestampNs);
+            }
+            return std::make_tuple(false, "", "", false, "", "", uint64_t(0), int64_t(0));
+        }
+
         std::string msg = msg_ptr->to_string();
         rapidjson::Document d;
         d.Parse(msg.c_str());
-        if (d.HasMember("data") &&
+        if (d.IsObject() &&
+            d.HasMember("data") &&
             d.HasMember("room") &&
             d.HasMember("bed") &&
             d.HasMember("timestamp") &&
@@ -209,24 +381,43 @@ std::tuple<bool, std::string, std::string, bool, std::string, std::string> Clien
             std::string room(d["room"].GetString(), d["room"].GetStringLength());
             std::string bed(d["bed"].GetString(), d["bed"].GetStringLength());
 
+            // Not sent by older publishers
+            uint64_t sequence = d.HasMember("sequence") && d["sequence"].IsUint64() ? d["sequence"].GetUint64() : 0;
+            int64_t timestampNs = d.HasMember("timestampNs") && d["timestampNs"].IsInt64() ? d["timestampNs"].GetInt64() : 0;
+
             if (d["data"].IsBool()) {
                 bool ret(d["data"].GetBool());
-                return make_tuple(true, room, bed, ret, clientId, timestamp);
+                return make_tuple(true, room, bed, ret, clientId, timestamp, sequence, timestampNs);
             }
         }
     }
 
-    return std::make_tuple(false, "", "", false, "", "");
+    return std::make_tuple(false, "", "", false, "", "", uint64_t(0), int64_t(0));
 }
 
-std::tuple<bool, std::string, std::string, std::string, std::string, std::string> Client::getString(const std::string topic) {
+std::tuple<bool, std::string, std::string, std::string, std::string, std::string, uint64_t, int64_t> Client::getString(const std::string topic) {
     auto buffer = getBuffer(topic);
     if (!buffer->empty()) {
         mqtt::const_message_ptr msg_ptr = buffer->get();
+
+        BinaryPayloadHeader header;
+        const std::string &payload = msg_ptr->get_payload_str();
+        if (decodeBinaryPayload(payload, header)) {
+            if (header.flags & BINARY_FLAG_STRING) {
+                char timestamp[utils::TIMESTAMP_LENGTH + 1];
+                utils::formatTimestamp(timestamp, header.timestampNs);
+                return make_tuple(true, binaryIdString(header.room), binaryIdString(header.bed),
+                                  payload.substr(sizeof(header)), std::string(), std::string(timestamp),
+                                  header.sequence, header.timestampNs);
+            }
+            return std::make_tuple(false, "", "", "", "", "", uint64_t(0), int64_t(0));
+        }
+
         std::string msg = msg_ptr->to_string();
         rapidjson::Document d;
         d.Parse(msg.c_str());
-        if (d.HasMember("data") &&
+        if (d.IsObject() &&
+            d.HasMember("data") &&
             d.HasMember("room") &&
             d.HasMember("bed") &&
             d.HasMember("timestamp") &&
@@ -236,51 +427,51 @@ std::tuple<bool, std::string, std::string, std::string, std::string, std::string
             std::string room(d["room"].GetString(), d["room"].GetStringLength());
             std::string bed(d["bed"].GetString(), d["bed"].GetStringLength());
 
+            // Not sent by older publishers
+            uint64_t sequence = d.HasMember("sequence") && d["sequence"].IsUint64() ? d["sequence"].GetUint64() : 0;
+            int64_t timestampNs = d.HasMember("timestampNs") && d["timestampNs"].IsInt64() ? d["timestampNs"].GetInt64() : 0;
+
             if (d["data"].IsString()) {
                 std::string ret(d["data"].GetString(), d["data"].GetStringLength());
-                return make_tuple(true, room, bed, ret, clientId, timestamp);
+                return make_tuple(true, room, bed, ret, clientId, timestamp, sequence, timestampNs);
             }
         }
     }
 
-    return std::make_tuple(false, "", "", "", "", "");
+    return std::make_tuple(false, "", "", "", "", "", uint64_t(0), int64_t(0));
 }
 
 /******************************************
  * PRIVATE MEMBERS
  * ***************************************/
 
-void Client::start() {
-    if (!_client.is_connected()) {
-        std::cerr << CLIENT_LOG << "Called start() but the client is not connected." << std::endl;
+void Client::messageArrived(mqtt::const_message_ptr msg) {
+    if (msg->get_payload() == "INIT") {
         return;
     }
 
-    _client.start_consuming();
-    mRunning = true;
-
-    while (_client.is_connected()) {
-        mqtt::const_message_ptr msg;
-        if (_client.try_consume_message_for(&msg, std::chrono::seconds(2))) {
-            // Check if the message we received is the special stop signal
-            if (msg->get_topic() == NODE_END && msg->get_payload().c_str() == mClientId) {
-                std::cout << CLIENT_LOG << "Received NODE_END - stopping consuming thread...." << std::endl;
-                break;
-            }
-            // Otherwise, process the message
-            else {
-                if (msg->get_payload() != "INIT") {
-                    if (!putMessage(msg)) {
-                        std::cerr << CLIENT_LOG << "Failed to process incoming message in topic: " << msg->get_topic() << std::endl;
-                    }
-                }
-            }
+    // Handled topics skip the buffers
+    MessageHandler handler;
+    {
+        const std::lock_guard<std::mutex> lock(mMutexBuffer);
+        auto it = mHandlers.find(msg->get_topic());
+        if (it != mHandlers.end()) {
+            handler = it->second;
         }
     }
+    if (handler) {
+        handler(msg);
+        return;
+    }
 
-    // Stop consuming messages
-    _client.stop_consuming();
-    mRunning = false;
+    // Clears a retained message, e.g. a node's last will, and carries nothing to read
+    if (msg->get_payload().empty()) {
+        return;
+    }
+
+    if (!putMessage(msg)) {
+        std::cerr << CLIENT_LOG << "Failed to process incoming message in topic: " << msg->get_topic() << std::endl;
+    }
 }
 
 bool Client::putMessage(mqtt::const_message_ptr input) {
@@ -316,22 +507,137 @@ CircularBuffer<mqtt::const_message_ptr> *Client::getBuffer(const std::string top
     return new CircularBuffer<mqtt::const_message_ptr>(5);
 }
 
-bool Client::publish(const char *pubMsg, std::string topic) {
-    // Publish message over MQTT
-    mqtt::delivery_token_ptr pubtok;
-    const std::lock_guard<std::mutex> lock(mMutexPublish);
-    if (_client.is_connected()) {
-        if (_client.publish(topic, pubMsg, strlen(pubMsg), QOS, false)->wait_for(TIMEOUT)) {
-            // std::cout << CLIENT_LOG << "Successfully published message on topic: " << topic << std::endl;
-            return true;
+bool Client::enqueue(const std::string &topic, const PayloadFormatter &format, const std::string &correlation) {
+    if (!_client.is_connected()) {
+        std::cerr << CLIENT_LOG << "Client is not connected - cannot publish messages" << std::endl;
+        return false;
+    }
+
+    {
+        // Numbered and formatted under the lock, so sequence numbers reach
+        // the queue in order even when several threads publish on a topic
+        const std::lock_guard<std::mutex> lock(mMutexPublish);
+
+        // A newer state supersedes the one still waiting for a free slot and
+        // takes over its number, the replaced one was never sent. Replies
+        // carrying correlation data each answer their own request, so they
+        // are neither replaced nor replace anything.
+        if (getPolicy(topic).coalesce && correlation.empty()) {
+            for (auto &pending : mQueue) {
+                if (pending.topic == topic && pending.correlation.empty()) {
+                    pending.payload = format(pending.sequence);
+                    return true;
+                }
+            }
         }
 
-        std::cerr << CLIENT_LOG << "Timed out publishing message in topic: " << topic << std::endl;
+        if (mQueue.size() >= MAX_QUEUED) {
+            std::cerr << CLIENT_LOG << "Publish queue is full, dropping message in topic: " << topic << std::endl;
+            return false;
+        }
+
+        uint64_t sequence = ++mSequence;
+        mQueue.push_back({topic, format(sequence), correlation, sequence});
+    }
+
+    sendQueued();
+    return true;
+}
+
+// Called with mMutexPublish held
+TopicPolicy Client::getPolicy(const std::string &topic) const {
+    auto it = mTopicPolicies.find(topic);
+    if (it != mTopicPolicies.end()) {
+        return it->second;
+    }
+    return TopicPolicy();
+}
+
+TopicPolicy Client::policyFor(const std::string &topic) {
+    const std::lock_guard<std::mutex> lock(mMutexPublish);
+    return getPolicy(topic);
+}
+
+bool Client::publishBinary(uint8_t flags, uint8_t value, const std::string &room, const std::string &bed,
+                           const std::string &text, const std::string &topic) {
+    BinaryPayloadHeader header = {};
+    header.version = BINARY_PAYLOAD_VERSION;
+    header.flags = flags;
+    header.value = value;
+    header.room = binaryId(room);
+    header.bed = binaryId(bed);
+    header.timestampNs = utils::epochNs();
+
+    bool queued = enqueue(topic, [&](uint64_t sequence) {
+        header.sequence = sequence;
+        std::shared_ptr<std::string> payload = std::make_shared<std::string>();
+        encodeBinaryPayload(header, text.data(), text.size(), *payload);
+        return std::shared_ptr<const std::string>(payload);
+    });
+    if (!queued) {
+        std::cerr << CLIENT_LOG << "Failed to log signal to " << topic << std::endl;
         return false;
     }
 
-    std::cerr << CLIENT_LOG << "Client is not connected - cannot publish messages" << std::endl;
-    return false;
+    return true;
+}
+
+void Client::sendQueued() {
+    while (true) {
+        PendingMessage message;
+        TopicPolicy policy;
+        {
+            const std::lock_guard<std::mutex> lock(mMutexPublish);
+            if (mQueue.empty() || mInFlight >= MAX_IN_FLIGHT) {
+                return;
+            }
+            message = std::move(mQueue.front());
+            mQueue.pop_front();
+            policy = getPolicy(message.topic);
+            mInFlight++;
+        }
+
+        mqtt::properties properties;
+        if (policy.expirySeconds > 0 && mMqttVersion >= MQTTVERSION_5) {
+            properties.add(mqtt::property(mqtt::property::MESSAGE_EXPIRY_INTERVAL, policy.expirySeconds));
+        }
+        if (!message.correlation.empty() && mMqttVersion >= MQTTVERSION_5) {
+            properties.add(mqtt::property(mqtt::property::CORRELATION_DATA, mqtt::binary_ref(message.correlation)));
+        }
+
+        // Sent outside the lock, Paho may report the outcome on another thread right away
+        DeliveryListener *listener = new DeliveryListener(mOwner, message.topic);
+        try {
+            // An empty payload only means something retained, it clears the topic
+            bool retain = policy.retain || message.payload->empty();
+            mqtt::message_ptr msg = mqtt::message::create(message.topic, mqtt::binary_ref(message.payload),
+                                                          policy.qos, retain, properties);
+            _client.publish(msg, nullptr, *listener);
+        } catch (const mqtt::exception &) {
+            delete listener;
+            delivered(message.topic, false);
+        }
+    }
+}
+
+void Client::delivered(const std::string &topic, bool success) {
+    std::function<void(const std::string &, bool)> callback;
+    {
+        const std::lock_guard<std::mutex> lock(mMutexPublish);
+        mInFlight--;
+        callback = mDeliveryCallback;
+    }
+    mDelivered.notify_all();
+
+    if (!success) {
+        std::cerr << CLIENT_LOG << "Failed publishing message in topic: " << topic << std::endl;
+    }
+    if (callback) {
+        callback(topic, success);
+    }
+
+    // The freed slot goes to the next queued message
+    sendQueued();
 }
 
 }  // namespace network
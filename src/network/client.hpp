@@ -1,13 +1,17 @@
 #ifndef __TETON_NETWORK_MQTT_CLIENT_HPP__
 #define __TETON_NETWORK_MQTT_CLIENT_HPP__
 
+#include <map>
+#include <deque>
 #include <mutex>
-#include <thread>
+#include <memory>
 #include <string>
 #include <chrono>
 #include <atomic>
 #include <fstream>
 #include <iostream>
+#include <functional>
+#include <condition_variable>
 
 #include "Base64.h"
 #include "rapidjson/writer.h"
@@ -15,25 +19,54 @@
 #include "rapidjson/stringbuffer.h"
 
 #include "mqtt/async_client.h"
-#include <boost/date_time/posix_time/posix_time.hpp>
 
 #include "../utils/utils.hpp"
+#include "../utils/timestamp.hpp"
 #include "circular_buffer.hpp"
+#include "binary_payload.hpp"
+#include "prepared_message.hpp"
 
 namespace teton {
 namespace network {
 
+// Encoding of published payloads, see binary_payload.hpp
+enum class PayloadFormat {
+    Json,
+    Binary,
+};
+
+// How messages on a topic are published
+struct TopicPolicy {
+    int qos = 2;
+    bool retain = false;
+    PayloadFormat format = PayloadFormat::Json;
+
+    // Seconds after which the broker discards the message, 0 keeps it. Only
+    // honoured on MQTT v5 connections.
+    int expirySeconds = 0;
+
+    // Only the latest queued value is sent, older unsent ones are replaced.
+    // Replies carrying MQTT v5 correlation data are always sent.
+    bool coalesce = false;
+};
+
 class Client {
    public:
-    Client(std::string host, std::string clientId);
+    Client(std::string host, std::string clientId, int mqttVersion = MQTTVERSION_3_1_1);
     ~Client();
 
     bool connect();
     bool disconnect();
 
+    // Messages on these topics are buffered for getBool() and getString()
     bool subscribe(const std::string topic);
     bool subscribe(std::vector<std::string> topic);
 
+    // Messages on this topic are passed to the handler right from Paho's
+    // callback thread instead of being buffered. It must not block.
+    typedef std::function<void(const mqtt::const_message_ptr &)> MessageHandler;
+    bool subscribe(const std::string topic, MessageHandler handler);
+
     inline bool empty(const std::string topic) {
         auto buffer = getBuffer(topic);
         return buffer->empty();
@@ -46,32 +79,100 @@ class Client {
 
     bool isConnected();
 
+    // Publishes never wait for the broker. Messages are queued and at most
+    // MAX_IN_FLIGHT of them are unacknowledged at a time, true means queued.
     bool publish(bool signal, std::string clientid, std::string room, std::string bed, std::string topic);
     bool publish(std::string signal, std::string clientid, std::string room, std::string bed, std::string topic);
     bool publish(const char *signal, std::string clientid, std::string room, std::string bed, std::string topic);
 
-    std::tuple<bool, std::string, std::string, bool, std::string, std::string> getBool(const std::string topic);
-    std::tuple<bool, std::string, std::string, std::string, std::string, std::string> getString(const std::string topic);
+    // Same message as publish(bool, ...), without building a JSON document
+    bool publish(bool signal, PreparedMessage &message, std::string topic);
+
+    // Answers a request received by a handler. On MQTT v5 connections the
+    // reply goes to the request's response topic, if it set one, and carries
+    // its correlation data. Otherwise it is published on topic.
+    bool reply(const mqtt::const_message_ptr &request, bool signal, PreparedMessage &message, std::string topic);
+
+    // Invoked from Paho's threads once a queued message was acknowledged or failed
+    void setDeliveryCallback(std::function<void(const std::string &, bool)> callback);
+
+    // Topics without a policy are published as JSON at QoS 2, not retained.
+    // getBool() and getString() read either format.
+    void setTopicPolicy(const std::string topic, const TopicPolicy &policy);
+
+    // Published by the broker when the connection drops without a clean
+    // disconnect. Must be set before connect().
+    void setLastWill(const std::string topic, const std::string payload, int qos, bool retain);
+
+    // Removes the retained message of a topic from the broker by publishing
+    // an empty retained message behind everything already queued
+    bool clearRetained(const std::string topic);
+
+    // Waits until every queued message was acknowledged or failed
+    bool flush(std::chrono::milliseconds timeout);
+
+    // Tuples of (valid, room, bed, data, clientId, timestamp, sequence,
+    // timestampNs). The sequence counts all publishes of the sending client
+    // from 1, on every topic, so it stays far below 2^53 where JavaScript
+    // consumers would lose precision. On one topic it only grows while the
+    // client runs, so an equal or lower number is a redelivery. It starts
+    // over after a restart, which JSON payloads tell apart by the client's
+    // start time in "bootMs". Sequence and timestampNs are 0 for publishers
+    // that do not send them.
+    std::tuple<bool, std::string, std::string, bool, std::string, std::string, uint64_t, int64_t> getBool(const std::string topic);
+    std::tuple<bool, std::string, std::string, std::string, std::string, std::string, uint64_t, int64_t> getString(const std::string topic);
 
    private:
     std::string mClientId;
-    std::atomic<bool> mRunning;
-    std::vector<std::thread> mThreads;
+    int mMqttVersion;
+    int64_t mBootMs;  // start of the client, milliseconds since the Unix epoch
+    uint64_t mSequence;  // last assigned sequence, guarded by mMutexPublish
     std::mutex mMutexPublish, mMutexBuffer;
+    std::function<void(const std::string &, bool)> mDeliveryCallback;
+    std::unique_ptr<mqtt::will_options> mWill;
+
+    struct PendingMessage {
+        std::string topic;
+        std::shared_ptr<const std::string> payload;  // shared with Paho, never copied
+        std::string correlation;                     // MQTT v5 correlation data of a reply
+        uint64_t sequence;
+    };
+
+    // Builds the payload for the sequence number assigned by enqueue()
+    typedef std::function<std::shared_ptr<const std::string>(uint64_t sequence)> PayloadFormatter;
+    struct Owner;
+    class DeliveryListener;
+
+    std::shared_ptr<Owner> mOwner;
+    std::deque<PendingMessage> mQueue;
+    size_t mInFlight;
+    std::map<std::string, TopicPolicy> mTopicPolicies;
+    std::condition_variable mDelivered;
 
     mqtt::async_client _client;
     std::map<std::string, CircularBuffer<mqtt::const_message_ptr> *> pendingSubscriptions;
+    std::map<std::string, MessageHandler> mHandlers;
 
-    void start();
+    void messageArrived(mqtt::const_message_ptr msg);
     bool putMessage(mqtt::const_message_ptr input);
     CircularBuffer<mqtt::const_message_ptr> *getBuffer(const std::string topic);
-    bool publish(const char *output, std::string topic);
-
-    inline std::string getTimestamp() const {
-        boost::posix_time::ptime t = boost::posix_time::microsec_clock::universal_time();
-        std::string datetime = to_iso_extended_string(t) + "Z";
-        std::cout << datetime << std::endl;
-        return datetime;
+    bool publish(bool signal, PreparedMessage &message, const std::string &topic, const std::string &correlation);
+    bool enqueue(const std::string &topic, const PayloadFormatter &format,
+                 const std::string &correlation = std::string());
+    TopicPolicy getPolicy(const std::string &topic) const;
+    TopicPolicy policyFor(const std::string &topic);
+    bool publishBinary(uint8_t flags, uint8_t value, const std::string &room, const std::string &bed,
+                       const std::string &text, const std::string &topic);
+    void sendQueued();
+    void delivered(const std::string &topic, bool success);
+
+    // Buffer must hold utils::TIMESTAMP_LENGTH + 1 chars
+    inline const char *getTimestamp(char *buffer, int64_t timestampNs) const {
+        utils::formatTimestamp(buffer, timestampNs);
+#ifdef TETON_TRACE
+        std::cout << buffer << '\n';
+#endif
+        return buffer;
     }
 };
 
@@ -0,0 +1,84 @@
+#include "prepared_message.hpp"
+
+#include <atomic>
+#include <cstdio>
+#include <cinttypes>
+
+#include "rapidjson/writer.h"
+#include "rapidjson/stringbuffer.h"
+
+#include "binary_payload.hpp"
+
+namespace teton {
+namespace network {
+
+PreparedMessage::PreparedMessage(const std::string &clientId, const std::string &room, const std::string &bed) :
+    mRoomId(binaryId(room)),
+    mBedId(binaryId(bed)) {
+    // rapidjson takes care of escaping, the closing brace is replaced by the variable fields
+    rapidjson::StringBuffer strBuffer;
+    rapidjson::Writer<rapidjson::StringBuffer> writer(strBuffer);
+    writer.StartObject();
+    writer.Key("room");
+    writer.String(room.c_str(), room.length());
+    writer.Key("bed");
+    writer.String(bed.c_str(), bed.length());
+    writer.Key("clientId");
+    writer.String(clientId.c_str(), clientId.length());
+    writer.EndObject();
+
+    mPrefix.assign(strBuffer.GetString(), strBuffer.GetSize() - 1);
+    mPrefix += ",\"data\":";
+}
+
+std::shared_ptr<const std::string> PreparedMessage::format(bool data, const char *timestamp, int64_t timestampNs,
+                                                           int64_t bootMs, uint64_t sequence) {
+    std::shared_ptr<std::string> &buffer = freeBuffer();
+
+    // The numbers fit a stack buffer, std::to_string would allocate
+    char numbers[128];
+    int length = snprintf(numbers, sizeof(numbers),
+                          "\",\"timestampNs\":%" PRId64 ",\"bootMs\":%" PRId64 ",\"sequence\":%" PRIu64 "}",
+                          timestampNs, bootMs, sequence);
+
+    // Fits the buffer's capacity after the first use
+    buffer->assign(mPrefix);
+    buffer->append(data ? "true" : "false");
+    buffer->append(",\"timestamp\":\"");
+    buffer->append(timestamp);
+    buffer->append(numbers, length);
+    return buffer;
+}
+
+std::shared_ptr<const std::string> PreparedMessage::formatBinary(bool data, int64_t timestampNs, uint64_t sequence) {
+    BinaryPayloadHeader header = {};
+    header.version = BINARY_PAYLOAD_VERSION;
+    header.flags = BINARY_FLAG_BOOL;
+    header.value = data ? 1 : 0;
+    header.room = mRoomId;
+    header.bed = mBedId;
+    header.sequence = sequence;
+    header.timestampNs = timestampNs;
+
+    std::shared_ptr<std::string> &buffer = freeBuffer();
+    encodeBinaryPayload(header, nullptr, 0, *buffer);
+    return buffer;
+}
+
+std::shared_ptr<std::string> &PreparedMessage::freeBuffer() {
+    for (auto &buffer : mBuffers) {
+        if (buffer.use_count() == 1) {
+            // Pairs with the release of the last reference on Paho's thread
+            std::atomic_thread_fence(std::memory_order_acquire);
+            return buffer;
+        }
+    }
+
+    // All buffers are queued or in flight
+    mBuffers.push_back(std::make_shared<std::string>());
+    mBuffers.back()->reserve(mPrefix.size() + 160);
+    return mBuffers.back();
+}
+
+}  // namespace network
+}  // namespace teton
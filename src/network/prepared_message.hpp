@@ -0,0 +1,42 @@
+#ifndef __TETON_NETWORK_PREPARED_MESSAGE_HPP__
+#define __TETON_NETWORK_PREPARED_MESSAGE_HPP__
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+namespace teton {
+namespace network {
+
+// JSON message of a node whose room, bed and clientId never change. They are
+// serialized once into a prefix, each format() only appends the data,
+// timestamps, the client's start time and the sequence number:
+//   {"room":"10","bed":"1","clientId":"...","data":true,"timestamp":"...","timestampNs":...,"bootMs":...,"sequence":...}
+//
+// formatBinary() fills the fixed header from binary_payload.hpp instead.
+//
+// Payloads are written into recycled buffers and handed to Paho by
+// reference. A buffer is reused as soon as Paho released it, so formatting
+// does not allocate once enough buffers for the messages in flight exist.
+class PreparedMessage {
+   public:
+    PreparedMessage(const std::string &clientId, const std::string &room, const std::string &bed);
+
+    std::shared_ptr<const std::string> format(bool data, const char *timestamp, int64_t timestampNs, int64_t bootMs,
+                                              uint64_t sequence);
+    std::shared_ptr<const std::string> formatBinary(bool data, int64_t timestampNs, uint64_t sequence);
+
+   private:
+    std::string mPrefix;
+    uint16_t mRoomId;
+    uint16_t mBedId;
+    std::vector<std::shared_ptr<std::string>> mBuffers;
+
+    std::shared_ptr<std::string> &freeBuffer();
+};
+
+}  // namespace network
+}  // namespace teton
+
+#endif
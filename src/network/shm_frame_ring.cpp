@@ -0,0 +1,141 @@
+#include "shm_frame_ring.hpp"
+
+#include <ctime>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+namespace teton {
+namespace network {
+
+size_t shmSlotStride(uint32_t slotBytes) {
+    return sizeof(ShmSlotHeader) + cv::alignSize(slotBytes, 64);
+}
+
+size_t shmRingSize(uint32_t slotCount, uint32_t slotBytes) {
+    return sizeof(ShmRingHeader) + slotCount * shmSlotStride(slotBytes);
+}
+
+ShmFrameRingWriter::ShmFrameRingWriter(const std::string &name, uint32_t slotCount) :
+    name_(name),
+    slot_count_(slotCount) {
+    // empty constructor
+}
+
+ShmFrameRingWriter::~ShmFrameRingWriter() {
+    // Nobody attaches to a ring that no longer advances
+    if (mapping_ != nullptr) {
+        close();
+        shm_unlink(name_.c_str());
+    }
+}
+
+bool ShmFrameRingWriter::write(const cv::Mat &frame) {
+    size_t bytes = frame.total() * frame.elemSize();
+
+    // Larger frames, e.g. after the source was reopened, get a fresh ring
+    if (mapping_ != nullptr && bytes > reinterpret_cast<ShmRingHeader *>(mapping_)->slotBytes) {
+        printf("Frames grew to %zu bytes, recreating shared memory ring %s\n", bytes, name_.c_str());
+        close();
+    }
+    if (mapping_ == nullptr && !create(static_cast<uint32_t>(bytes))) {
+        return false;
+    }
+
+    ShmRingHeader *ring = reinterpret_cast<ShmRingHeader *>(mapping_);
+
+    uint64_t index = next_++;
+    unsigned char *slotStart = mapping_ + sizeof(ShmRingHeader) + (index % slot_count_) * shmSlotStride(ring->slotBytes);
+    ShmSlotHeader *slot = reinterpret_cast<ShmSlotHeader *>(slotStart);
+    unsigned char *pixels = slotStart + sizeof(ShmSlotHeader);
+
+    // Odd sequence: readers of this slot will notice they raced with us
+    slot->sequence.store(2 * index + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    slot->timestampNs = static_cast<int64_t>(now.tv_sec) * 1000000000 + now.tv_nsec;
+    slot->rows = frame.rows;
+    slot->cols = frame.cols;
+    slot->type = frame.type();
+    slot->step = static_cast<uint32_t>(frame.cols * frame.elemSize());
+
+    // Rows are packed, so padded views are copied row by row
+    if (frame.isContinuous()) {
+        memcpy(pixels, frame.data, bytes);
+    } else {
+        for (int row = 0; row < frame.rows; row++) {
+            memcpy(pixels + row * slot->step, frame.ptr(row), slot->step);
+        }
+    }
+
+    slot->sequence.store(2 * index + 2, std::memory_order_release);
+    ring->head.store(index + 1, std::memory_order_release);
+    return true;
+}
+
+void ShmFrameRingWriter::close() {
+    // Attached readers detach and wait for the next ring
+    ShmRingHeader *ring = reinterpret_cast<ShmRingHeader *>(mapping_);
+    ring->closed.store(1, std::memory_order_release);
+    munmap(mapping_, length_);
+    mapping_ = nullptr;
+    length_ = 0;
+    next_ = 0;
+}
+
+bool ShmFrameRingWriter::create(uint32_t slotBytes) {
+    // A ring left behind by a crashed writer may still be mapped by readers.
+    // Resizing it would fault them, so the name is moved to a fresh object
+    // and they re-attach once they notice.
+    if (shm_unlink(name_.c_str()) != 0 && errno != ENOENT) {
+        perror(("Failed to replace shared memory " + name_).c_str());
+        return false;
+    }
+    int fd = shm_open(name_.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0) {
+        perror(("Failed to open shared memory " + name_).c_str());
+        return false;
+    }
+
+    size_t length = shmRingSize(slot_count_, slotBytes);
+    if (ftruncate(fd, static_cast<off_t>(length)) != 0) {
+        perror(("Failed to size shared memory " + name_).c_str());
+        ::close(fd);
+        return false;
+    }
+
+    void *mapping = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        perror(("Failed to map shared memory " + name_).c_str());
+        return false;
+    }
+    mapping_ = static_cast<unsigned char *>(mapping);
+    length_ = length;
+
+    // The magic goes in last, readers treat a ring without it as not ready yet
+    ShmRingHeader *ring = reinterpret_cast<ShmRingHeader *>(mapping_);
+    ring->magic = 0;
+    std::atomic_thread_fence(std::memory_order_release);
+    ring->version = ShmRingHeader::VERSION;
+    ring->slotCount = slot_count_;
+    ring->slotBytes = slotBytes;
+    ring->head.store(0, std::memory_order_relaxed);
+    ring->closed.store(0, std::memory_order_relaxed);
+    for (uint32_t i = 0; i < slot_count_; i++) {
+        ShmSlotHeader *slot = reinterpret_cast<ShmSlotHeader *>(mapping_ + sizeof(ShmRingHeader) + i * shmSlotStride(slotBytes));
+        slot->sequence.store(0, std::memory_order_relaxed);
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+    ring->magic = ShmRingHeader::MAGIC;
+
+    return true;
+}
+
+}  // namespace network
+}  // namespace teton
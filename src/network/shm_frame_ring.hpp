@@ -0,0 +1,73 @@
+#ifndef __TETON_NETWORK_SHM_FRAME_RING_HPP__
+#define __TETON_NETWORK_SHM_FRAME_RING_HPP__
+
+#include <atomic>
+#include <string>
+#include <cstdint>
+#include <opencv2/core.hpp>
+
+namespace teton {
+namespace network {
+
+// Layout of the frame ring shared between local processes through POSIX
+// shared memory. Like CircularBuffer the newest item overwrites the oldest,
+// but there is exactly one writer and any number of readers, so slots are
+// guarded by seqlocks instead of a mutex: a slot's sequence is odd while it
+// is being written, and a reader that sees it change knows it was lapped.
+//
+// Every writer creates a fresh object under the ring's name and never resizes
+// it, so head only grows within one mapping. Readers re-attach when the
+// writer closed its ring or the name was taken over by a new one.
+struct ShmRingHeader {
+    static const uint32_t MAGIC = 0x544c4544;  // "TLED"
+    static const uint32_t VERSION = 2;
+
+    uint32_t magic;
+    uint32_t version;
+    uint32_t slotCount;
+    uint32_t slotBytes;            // pixel capacity of each slot
+    std::atomic<uint64_t> head;    // number of frames written so far
+    std::atomic<uint32_t> closed;  // set once the writer went away cleanly
+    char padding[36];
+};
+
+struct alignas(64) ShmSlotHeader {
+    std::atomic<uint64_t> sequence;  // 2 * frame + 1 while writing, 2 * frame + 2 once complete
+    int64_t timestampNs;             // CLOCK_REALTIME when the frame was published
+    int32_t rows;
+    int32_t cols;
+    int32_t type;
+    uint32_t step;
+};
+
+static_assert(sizeof(ShmRingHeader) == 64, "ShmRingHeader must fill one cache line");
+
+// Byte offsets inside the mapping, shared by writer and readers
+size_t shmSlotStride(uint32_t slotBytes);
+size_t shmRingSize(uint32_t slotCount, uint32_t slotBytes);
+
+// Publishes frames into the ring, which is created on the first frame and
+// sized after it. A larger frame replaces the ring with a fresh one. The
+// ring is closed and unlinked again on destruction.
+class ShmFrameRingWriter {
+   public:
+    ShmFrameRingWriter(const std::string &name, uint32_t slotCount);
+    ~ShmFrameRingWriter();
+
+    bool write(const cv::Mat &frame);
+
+   private:
+    const std::string name_;
+    const uint32_t slot_count_;
+    unsigned char *mapping_ = nullptr;
+    size_t length_ = 0;
+    uint64_t next_ = 0;
+
+    bool create(uint32_t slotBytes);
+    void close();
+};
+
+}  // namespace network
+}  // namespace teton
+
+#endif
@@ -0,0 +1,27 @@
+#include "clock.hpp"
+
+namespace teton {
+namespace utils {
+
+Clock::Clock(bool simulated) :
+    mSimulated(simulated),
+    mStart(std::chrono::steady_clock::now()),
+    mSimulatedNow(duration::zero()) {
+    // empty constructor
+}
+
+Clock::duration Clock::now() const {
+    if (mSimulated) {
+        return mSimulatedNow;
+    }
+    return std::chrono::steady_clock::now() - mStart;
+}
+
+void Clock::advance(duration to) {
+    if (mSimulated && to > mSimulatedNow) {
+        mSimulatedNow = to;
+    }
+}
+
+}  // namespace utils
+}  // namespace teton
@@ -0,0 +1,32 @@
+#ifndef __TETON_UTILS_CLOCK_HPP__
+#define __TETON_UTILS_CLOCK_HPP__
+
+#include <chrono>
+
+namespace teton {
+namespace utils {
+
+// Time since start used for the node's periodic decisions. Follows the
+// steady clock, or in simulated mode only moves when advance() is called,
+// so replays running faster than real time keep production timing.
+class Clock {
+   public:
+    typedef std::chrono::steady_clock::duration duration;
+
+    explicit Clock(bool simulated = false);
+
+    duration now() const;
+    void advance(duration to);
+
+    bool simulated() const { return mSimulated; }
+
+   private:
+    const bool mSimulated;
+    const std::chrono::steady_clock::time_point mStart;
+    duration mSimulatedNow;
+};
+
+}  // namespace utils
+}  // namespace teton
+
+#endif
@@ -0,0 +1,168 @@
+#include "event_loop.hpp"
+
+#include <cerrno>
+#include <cstdio>
+#include <utility>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <sys/signalfd.h>
+
+namespace teton {
+namespace utils {
+
+const int MAX_EVENTS = 8;
+
+EventLoop::EventLoop() :
+    mEpollFd(epoll_create1(EPOLL_CLOEXEC)),
+    mRunning(false) {
+    if (mEpollFd < 0) {
+        perror("Failed to create epoll instance");
+    }
+}
+
+EventLoop::~EventLoop() {
+    if (mEpollFd >= 0) {
+        close(mEpollFd);
+    }
+}
+
+bool EventLoop::add(int fd, std::function<void()> handler) {
+    epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.fd = fd;
+    if (epoll_ctl(mEpollFd, EPOLL_CTL_ADD, fd, &event) != 0) {
+        perror("Failed to add file descriptor to event loop");
+        return false;
+    }
+
+    mHandlers[fd] = std::make_shared<std::function<void()>>(std::move(handler));
+    return true;
+}
+
+bool EventLoop::remove(int fd) {
+    mHandlers.erase(fd);
+    return epoll_ctl(mEpollFd, EPOLL_CTL_DEL, fd, nullptr) == 0;
+}
+
+void EventLoop::run() {
+    epoll_event events[MAX_EVENTS];
+
+    mRunning = true;
+    while (mRunning) {
+        int count = epoll_wait(mEpollFd, events, MAX_EVENTS, -1);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("Failed to wait for events");
+            break;
+        }
+
+        for (int i = 0; i < count && mRunning; i++) {
+            auto it = mHandlers.find(events[i].data.fd);
+            if (it != mHandlers.end()) {
+                std::shared_ptr<std::function<void()>> handler = it->second;
+                (*handler)();
+            }
+        }
+    }
+}
+
+void EventLoop::stop() {
+    mRunning = false;
+}
+
+EventFd::EventFd(bool semaphore) :
+    mFd(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC | (semaphore ? EFD_SEMAPHORE : 0))) {
+    if (mFd < 0) {
+        perror("Failed to create eventfd");
+    }
+}
+
+EventFd::~EventFd() {
+    if (mFd >= 0) {
+        close(mFd);
+    }
+}
+
+void EventFd::notify() {
+    uint64_t one = 1;
+    ssize_t written = write(mFd, &one, sizeof(one));
+    (void)written;
+}
+
+uint64_t EventFd::drain() {
+    uint64_t count = 0;
+    if (::read(mFd, &count, sizeof(count)) != sizeof(count)) {
+        return 0;
+    }
+    return count;
+}
+
+TimerFd::TimerFd() :
+    mFd(timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC)) {
+    if (mFd < 0) {
+        perror("Failed to create timerfd");
+    }
+}
+
+TimerFd::~TimerFd() {
+    if (mFd >= 0) {
+        close(mFd);
+    }
+}
+
+bool TimerFd::arm(std::chrono::nanoseconds initial, std::chrono::nanoseconds period) {
+    itimerspec spec = {};
+    spec.it_value.tv_sec = initial.count() / 1000000000;
+    spec.it_value.tv_nsec = initial.count() % 1000000000;
+    spec.it_interval.tv_sec = period.count() / 1000000000;
+    spec.it_interval.tv_nsec = period.count() % 1000000000;
+    return timerfd_settime(mFd, 0, &spec, nullptr) == 0;
+}
+
+uint64_t TimerFd::drain() {
+    uint64_t expirations = 0;
+    if (::read(mFd, &expirations, sizeof(expirations)) != sizeof(expirations)) {
+        return 0;
+    }
+    return expirations;
+}
+
+SignalFd::SignalFd(std::initializer_list<int> signals) {
+    sigset_t mask;
+    sigemptyset(&mask);
+    for (int signo : signals) {
+        sigaddset(&mask, signo);
+    }
+
+    // Threads started afterwards inherit the mask, so only this fd sees the signals
+    if (pthread_sigmask(SIG_BLOCK, &mask, nullptr) != 0) {
+        perror("Failed to block signals");
+    }
+
+    mFd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (mFd < 0) {
+        perror("Failed to create signalfd");
+    }
+}
+
+SignalFd::~SignalFd() {
+    if (mFd >= 0) {
+        close(mFd);
+    }
+}
+
+int SignalFd::read() {
+    signalfd_siginfo info;
+    if (::read(mFd, &info, sizeof(info)) != sizeof(info)) {
+        return 0;
+    }
+    return static_cast<int>(info.ssi_signo);
+}
+
+}  // namespace utils
+}  // namespace teton
@@ -0,0 +1,82 @@
+#ifndef __TETON_UTILS_EVENT_LOOP_HPP__
+#define __TETON_UTILS_EVENT_LOOP_HPP__
+
+#include <map>
+#include <memory>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+
+namespace teton {
+namespace utils {
+
+// Single-threaded epoll loop dispatching readable file descriptors to handlers.
+// Handlers may add or remove any fd, including their own.
+class EventLoop {
+   public:
+    EventLoop();
+    ~EventLoop();
+
+    bool add(int fd, std::function<void()> handler);
+    bool remove(int fd);
+
+    // Dispatches events until stop() is called from one of the handlers
+    void run();
+    void stop();
+
+   private:
+    int mEpollFd;
+    bool mRunning;
+    // Shared, so a handler that removes itself keeps running until it returns
+    std::map<int, std::shared_ptr<std::function<void()>>> mHandlers;
+};
+
+// Counter that other threads bump to wake up the event loop. In semaphore
+// mode every drain() consumes a single notification, so the fd stays
+// readable until each one was handled.
+class EventFd {
+   public:
+    explicit EventFd(bool semaphore = false);
+    ~EventFd();
+
+    int fd() const { return mFd; }
+    void notify();
+    uint64_t drain();
+
+   private:
+    int mFd;
+};
+
+// Periodic timer delivered through the event loop
+class TimerFd {
+   public:
+    TimerFd();
+    ~TimerFd();
+
+    int fd() const { return mFd; }
+    bool arm(std::chrono::nanoseconds initial, std::chrono::nanoseconds period);
+    uint64_t drain();
+
+   private:
+    int mFd;
+};
+
+// Blocks the given signals for the whole process and reports them as events.
+// Must be created before any other thread is started.
+class SignalFd {
+   public:
+    explicit SignalFd(std::initializer_list<int> signals);
+    ~SignalFd();
+
+    int fd() const { return mFd; }
+    int read();
+
+   private:
+    int mFd;
+};
+
+}  // namespace utils
+}  // namespace teton
+
+#endif
@@ -0,0 +1,34 @@
+#include "heartbeat_scheduler.hpp"
+
+#include <functional>
+
+namespace teton {
+namespace utils {
+
+HeartbeatScheduler::HeartbeatScheduler(Clock::duration period, Clock::duration jitter, const std::string &deviceId) :
+    mPeriod(period),
+    mJitter(jitter),
+    mRandom(static_cast<std::minstd_rand::result_type>(std::hash<std::string>()(deviceId))) {
+    mNext = interval();
+}
+
+void HeartbeatScheduler::reset(Clock::duration now) {
+    mNext = now + interval();
+}
+
+Clock::duration HeartbeatScheduler::remaining(Clock::duration now) const {
+    Clock::duration left = mNext - now;
+    return left > std::chrono::milliseconds(1) ? left : std::chrono::milliseconds(1);
+}
+
+Clock::duration HeartbeatScheduler::interval() {
+    long long jitterMs = std::chrono::duration_cast<std::chrono::milliseconds>(mJitter).count();
+    if (jitterMs <= 0) {
+        return mPeriod;
+    }
+    std::uniform_int_distribution<long long> offset(-jitterMs / 2, jitterMs / 2);
+    return mPeriod + std::chrono::milliseconds(offset(mRandom));
+}
+
+}  // namespace utils
+}  // namespace teton
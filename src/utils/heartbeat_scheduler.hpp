@@ -0,0 +1,44 @@
+#ifndef __TETON_UTILS_HEARTBEAT_SCHEDULER_HPP__
+#define __TETON_UTILS_HEARTBEAT_SCHEDULER_HPP__
+
+#include <chrono>
+#include <random>
+#include <string>
+
+#include "clock.hpp"
+
+namespace teton {
+namespace utils {
+
+// Decides when a state has to be repeated. Every publish restarts the
+// period, so a heartbeat is only sent when nothing else was published for a
+// whole period. Each period is shifted by up to +-jitter/2, drawn from a
+// generator seeded with the device id, so devices started together spread
+// their heartbeats instead of hitting the broker in bursts. Times are on the
+// node's Clock, so simulated replays get the same schedule.
+class HeartbeatScheduler {
+   public:
+    // jitter has to be below period, so every interval is at least half a period
+    HeartbeatScheduler(Clock::duration period, Clock::duration jitter, const std::string &deviceId);
+
+    // Something was published at `now`
+    void reset(Clock::duration now);
+
+    bool due(Clock::duration now) const { return now >= mNext; }
+
+    // Time left until the next heartbeat, never zero so it can arm a timer
+    Clock::duration remaining(Clock::duration now) const;
+
+   private:
+    const Clock::duration mPeriod;
+    const Clock::duration mJitter;
+    std::minstd_rand mRandom;
+    Clock::duration mNext;
+
+    Clock::duration interval();
+};
+
+}  // namespace utils
+}  // namespace teton
+
+#endif
@@ -0,0 +1,48 @@
+#include "startup_timeline.hpp"
+
+#include <cstdio>
+
+namespace teton {
+namespace utils {
+
+StartupTimeline::StartupTimeline() :
+    mStart(std::chrono::steady_clock::now()) {
+    // empty constructor
+}
+
+void StartupTimeline::begin(const std::string &phase) {
+    auto now = std::chrono::steady_clock::now() - mStart;
+    std::lock_guard<std::mutex> lock(mMutex);
+    mPhases.push_back({phase, now, now});
+}
+
+void StartupTimeline::end(const std::string &phase) {
+    auto now = std::chrono::steady_clock::now() - mStart;
+    std::lock_guard<std::mutex> lock(mMutex);
+    for (auto &entry : mPhases) {
+        if (entry.name == phase) {
+            entry.end = now;
+        }
+    }
+}
+
+void StartupTimeline::mark(const std::string &phase) {
+    begin(phase);
+}
+
+void StartupTimeline::print() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    printf("Startup timeline:\n");
+    for (const auto &entry : mPhases) {
+        long long begin = std::chrono::duration_cast<std::chrono::milliseconds>(entry.begin).count();
+        long long end = std::chrono::duration_cast<std::chrono::milliseconds>(entry.end).count();
+        if (begin == end) {
+            printf("  %-16s %6lld ms\n", entry.name.c_str(), begin);
+        } else {
+            printf("  %-16s %6lld ms .. %6lld ms (%lld ms)\n", entry.name.c_str(), begin, end, end - begin);
+        }
+    }
+}
+
+}  // namespace utils
+}  // namespace teton
@@ -0,0 +1,41 @@
+#ifndef __TETON_UTILS_STARTUP_TIMELINE_HPP__
+#define __TETON_UTILS_STARTUP_TIMELINE_HPP__
+
+#include <mutex>
+#include <chrono>
+#include <string>
+#include <vector>
+
+namespace teton {
+namespace utils {
+
+// When each startup phase began and ended, relative to the timeline's
+// construction. Phases may be recorded from different threads.
+class StartupTimeline {
+   public:
+    StartupTimeline();
+
+    void begin(const std::string &phase);
+    void end(const std::string &phase);
+
+    // Phase without duration, e.g. the first decision
+    void mark(const std::string &phase);
+
+    void print() const;
+
+   private:
+    struct Phase {
+        std::string name;
+        std::chrono::steady_clock::duration begin;
+        std::chrono::steady_clock::duration end;
+    };
+
+    const std::chrono::steady_clock::time_point mStart;
+    mutable std::mutex mMutex;
+    std::vector<Phase> mPhases;
+};
+
+}  // namespace utils
+}  // namespace teton
+
+#endif
@@ -0,0 +1,101 @@
+#include "state_file.hpp"
+
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "timestamp.hpp"
+
+namespace teton {
+namespace utils {
+
+const uint32_t STATE_FILE_MAGIC = 0x54535453;  // "STST"
+const uint32_t STATE_FILE_VERSION = 1;
+
+static_assert(sizeof(StateRecord) == 64, "StateRecord must stay a single cache line");
+
+StateFile::StateFile(const std::string &path) :
+    mPath(path),
+    mRecord(nullptr) {
+    // empty constructor
+}
+
+StateFile::~StateFile() {
+    if (mRecord != nullptr) {
+        munmap(mRecord, sizeof(StateRecord));
+    }
+}
+
+bool StateFile::open() {
+    // A symlink planted in a shared directory must not redirect our writes
+    int fd = ::open(mPath.c_str(), O_CREAT | O_RDWR | O_NOFOLLOW | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        perror(("Failed to open state file " + mPath).c_str());
+        return false;
+    }
+
+    // Neither a device or FIFO, nor a file someone else prepared for us
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        perror("Failed to inspect state file");
+        close(fd);
+        return false;
+    }
+    if (!S_ISREG(info.st_mode) || info.st_uid != geteuid()) {
+        fprintf(stderr, "State file %s is not a regular file owned by us, ignoring it\n", mPath.c_str());
+        close(fd);
+        return false;
+    }
+
+    bool fresh = info.st_size < static_cast<off_t>(sizeof(StateRecord));
+    if (fresh && ftruncate(fd, sizeof(StateRecord)) != 0) {
+        perror("Failed to size state file");
+        close(fd);
+        return false;
+    }
+
+    void *mapping = mmap(nullptr, sizeof(StateRecord), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        perror("Failed to map state file");
+        return false;
+    }
+    mRecord = static_cast<StateRecord *>(mapping);
+
+    // Files from other versions or truncated by a crash start over
+    if (mRecord->magic != STATE_FILE_MAGIC || mRecord->version != STATE_FILE_VERSION) {
+        mRecord->timestampNs = 0;
+        mRecord->value = 0;
+        mRecord->version = STATE_FILE_VERSION;
+        mRecord->magic = STATE_FILE_MAGIC;
+    }
+    return true;
+}
+
+bool StateFile::load(bool &value, std::chrono::seconds maxAge) const {
+    if (mRecord == nullptr || mRecord->timestampNs == 0) {
+        return false;
+    }
+
+    int64_t age = epochNs() - mRecord->timestampNs;
+    if (age < 0 || age > std::chrono::duration_cast<std::chrono::nanoseconds>(maxAge).count()) {
+        return false;
+    }
+    value = mRecord->value != 0;
+    return true;
+}
+
+void StateFile::store(bool value) {
+    if (mRecord == nullptr) {
+        return;
+    }
+
+    // A crash in between leaves the new value with the old time, which only makes it look older
+    mRecord->value = value ? 1 : 0;
+    mRecord->timestampNs = epochNs();
+}
+
+}  // namespace utils
+}  // namespace teton
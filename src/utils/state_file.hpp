@@ -0,0 +1,44 @@
+#ifndef __TETON_UTILS_STATE_FILE_HPP__
+#define __TETON_UTILS_STATE_FILE_HPP__
+
+#include <chrono>
+#include <string>
+#include <cstdint>
+
+namespace teton {
+namespace utils {
+
+// Layout of the state file, a single cache line
+struct StateRecord {
+    uint32_t magic;       // STATE_FILE_MAGIC
+    uint32_t version;
+    int64_t timestampNs;  // CLOCK_REALTIME of the last store, 0 when never stored
+    uint8_t value;
+    uint8_t padding[47];
+};
+
+// A boolean and the time it was last stored, kept in a small memory-mapped
+// file so it survives restarts. Stores are plain writes into the mapping,
+// the kernel writes the page back on its own, so they are cheap enough for
+// every frame. A crashed process loses nothing, only a power loss can
+// lose the latest stores.
+class StateFile {
+   public:
+    explicit StateFile(const std::string &path);
+    ~StateFile();
+
+    bool open();
+
+    // False when nothing was stored within maxAge
+    bool load(bool &value, std::chrono::seconds maxAge) const;
+    void store(bool value);
+
+   private:
+    const std::string mPath;
+    StateRecord *mRecord;
+};
+
+}  // namespace utils
+}  // namespace teton
+
+#endif
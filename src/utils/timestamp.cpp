@@ -0,0 +1,49 @@
+#include "timestamp.hpp"
+
+#include <ctime>
+#include <cstdio>
+#include <cstring>
+
+namespace teton {
+namespace utils {
+
+const size_t SECOND_PREFIX_LENGTH = 19;  // "2020-05-04T12:30:15"
+
+int64_t epochNs() {
+    timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    return static_cast<int64_t>(now.tv_sec) * 1000000000 + now.tv_nsec;
+}
+
+const char *formatTimestamp(char *buffer, int64_t epochNs) {
+    thread_local time_t cachedSecond = -1;
+    thread_local char cachedPrefix[SECOND_PREFIX_LENGTH + 1];
+
+    time_t second = static_cast<time_t>(epochNs / 1000000000);
+    if (second != cachedSecond) {
+        tm utc;
+        gmtime_r(&second, &utc);
+        strftime(cachedPrefix, sizeof(cachedPrefix), "%Y-%m-%dT%H:%M:%S", &utc);
+        cachedSecond = second;
+    }
+    memcpy(buffer, cachedPrefix, SECOND_PREFIX_LENGTH);
+
+    // Fraction written back to front, faster than printf
+    int micros = static_cast<int>((epochNs % 1000000000) / 1000);
+    char *fraction = buffer + SECOND_PREFIX_LENGTH;
+    fraction[0] = '.';
+    for (int digit = 6; digit > 0; digit--) {
+        fraction[digit] = static_cast<char>('0' + micros % 10);
+        micros /= 10;
+    }
+    buffer[TIMESTAMP_LENGTH - 1] = 'Z';
+    buffer[TIMESTAMP_LENGTH] = '\0';
+    return buffer;
+}
+
+const char *formatTimestamp(char *buffer) {
+    return formatTimestamp(buffer, epochNs());
+}
+
+}  // namespace utils
+}  // namespace teton
@@ -0,0 +1,26 @@
+#ifndef __TETON_UTILS_TIMESTAMP_HPP__
+#define __TETON_UTILS_TIMESTAMP_HPP__
+
+#include <cstddef>
+#include <cstdint>
+
+namespace teton {
+namespace utils {
+
+// Length of "2020-05-04T12:30:15.123456Z", without the terminating zero
+const size_t TIMESTAMP_LENGTH = 27;
+
+// Nanoseconds since the Unix epoch
+int64_t epochNs();
+
+// Writes a UTC time in ISO-8601 with microseconds into buffer, which must
+// hold TIMESTAMP_LENGTH + 1 chars, and returns it. The date and time up to
+// the second are cached per thread, so within a second only the fraction is
+// formatted. Never allocates.
+const char *formatTimestamp(char *buffer, int64_t epochNs);
+const char *formatTimestamp(char *buffer);
+
+}  // namespace utils
+}  // namespace teton
+
+#endif
@@ -0,0 +1,64 @@
+#include "debug_renderer.hpp"
+
+#include <string>
+#include <opencv2/imgproc.hpp>
+#include <opencv2/highgui.hpp>
+
+namespace teton {
+namespace video {
+
+DebugRenderer::DebugRenderer(cv::MatAllocator *allocator, cv::Size size) :
+    allocator_(allocator),
+    size_(size),
+    running_(true) {
+    thread_ = std::thread(&DebugRenderer::render, this);
+}
+
+DebugRenderer::~DebugRenderer() {
+    running_ = false;
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+void DebugRenderer::submit(const cv::Mat &frame, bool led) {
+    std::pair<cv::Mat, bool> &slot = frames_.writeSlot();
+    slot.first.allocator = allocator_;
+
+    // A plain copy, downscaling is left to the render thread
+    frame.copyTo(slot.first);
+    slot.second = led;
+    frames_.publish();
+}
+
+void DebugRenderer::render() {
+    cv::Mat display;
+    while (running_) {
+        if (frames_.fetch()) {
+            std::pair<cv::Mat, bool> &slot = frames_.readSlot();
+
+            // Halving is done by the pyramid path, anything else by area
+            // averaging, both much cheaper than bilinear on full-size frames
+            if (slot.first.cols == 2 * size_.width && slot.first.rows == 2 * size_.height) {
+                cv::pyrDown(slot.first, display, size_);
+            } else {
+                cv::resize(slot.first, display, size_, 0, 0, cv::INTER_AREA);
+            }
+
+            std::string ledText = std::string("LED: ") + (slot.second ? "ON" : "OFF");
+            cv::putText(display, ledText, cv::Point(40, 50), cv::FONT_HERSHEY_COMPLEX, 1, cv::Scalar(255, 255, 255), 2);
+            cv::imshow("Debug Visualization", display);
+        }
+
+        // Also pumps the window's events while no new frame arrives
+        int keycode = cv::waitKey(10) & 0xff;
+        if (keycode == 27) {
+            closed_.notify();
+        }
+    }
+
+    cv::destroyAllWindows();
+}
+
+}  // namespace video
+}  // namespace teton
@@ -0,0 +1,45 @@
+#ifndef __TETON_VIDEO_DEBUG_RENDERER_HPP__
+#define __TETON_VIDEO_DEBUG_RENDERER_HPP__
+
+#include <atomic>
+#include <thread>
+#include <utility>
+#include <opencv2/core.hpp>
+
+#include "latest_mailbox.hpp"
+#include "../utils/event_loop.hpp"
+
+namespace teton {
+namespace video {
+
+// Debug visualization on its own thread, so drawing, imshow and waitKey
+// never delay the processing loop. The processing side only copies the frame
+// into a mailbox. The render thread downscales and shows whatever is newest,
+// frames it does not get to are dropped.
+class DebugRenderer {
+   public:
+    // Copies of submitted frames are allocated from allocator, if given
+    explicit DebugRenderer(cv::MatAllocator *allocator = nullptr, cv::Size size = cv::Size(960, 720));
+    ~DebugRenderer();
+
+    // Called by the processing loop for every evaluated frame
+    void submit(const cv::Mat &frame, bool led);
+
+    // Readable once the window was closed with ESC
+    int closedFd() const { return closed_.fd(); }
+
+   private:
+    cv::MatAllocator *const allocator_;
+    const cv::Size size_;
+    LatestMailbox<std::pair<cv::Mat, bool>> frames_;
+    utils::EventFd closed_;
+    std::atomic<bool> running_;
+    std::thread thread_;
+
+    void render();
+};
+
+}  // namespace video
+}  // namespace teton
+
+#endif
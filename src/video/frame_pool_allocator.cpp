@@ -0,0 +1,169 @@
+#include "frame_pool_allocator.hpp"
+
+#include <new>
+#include <cstdio>
+#include <cstdint>
+#include <unistd.h>
+#include <sys/mman.h>
+
+namespace teton {
+namespace video {
+
+const size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+FramePoolAllocator::FramePoolAllocator(size_t blockCount, bool hugePages) :
+    block_count_(blockCount),
+    huge_pages_(hugePages),
+    fallbacks_(0) {
+    // empty constructor
+}
+
+FramePoolAllocator::~FramePoolAllocator() {
+    // Mats still alive at this point would dangle, so the pool must outlive them
+    releaseArena();
+}
+
+cv::UMatData *FramePoolAllocator::allocate(int dims, const int *sizes, int type, void *data, size_t *step,
+                                           cv::AccessFlag flags, cv::UMatUsageFlags usageFlags) const {
+    // Same step computation as cv::StdMatAllocator
+    size_t total = CV_ELEM_SIZE(type);
+    for (int i = dims - 1; i >= 0; i--) {
+        if (step) {
+            if (data && step[i] != CV_AUTOSTEP) {
+                total = step[i];
+            } else {
+                step[i] = total;
+            }
+        }
+        total *= sizes[i];
+    }
+
+    if (data == nullptr) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (block_size_ == 0 || (total > block_size_ && idle())) {
+            createArena(total);
+        }
+        if (total <= block_size_ && !free_blocks_.empty()) {
+            unsigned char *block = free_blocks_.back();
+            free_blocks_.pop_back();
+            cv::UMatData *u = free_headers_.back();
+            free_headers_.pop_back();
+
+            new (u) cv::UMatData(this);
+            u->data = u->origdata = block;
+            u->size = total;
+            return u;
+        }
+    }
+
+    // User data, oversized frames and an exhausted pool go to the default allocator
+    if (data == nullptr) {
+        fallbacks_.fetch_add(1, std::memory_order_relaxed);
+    }
+    return cv::Mat::getStdAllocator()->allocate(dims, sizes, type, data, step, flags, usageFlags);
+}
+
+bool FramePoolAllocator::allocate(cv::UMatData *data, cv::AccessFlag accessflags, cv::UMatUsageFlags usageFlags) const {
+    return data != nullptr;
+}
+
+void FramePoolAllocator::deallocate(cv::UMatData *data) const {
+    if (data == nullptr) {
+        return;
+    }
+
+    unsigned char *block = data->origdata;
+    data->~UMatData();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    free_blocks_.push_back(block);
+    free_headers_.push_back(data);
+}
+
+bool FramePoolAllocator::reserve(size_t frameBytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (cv::alignSize(frameBytes, ALIGNMENT) == block_size_) {
+        return arena_ != nullptr;
+    }
+    if (!idle()) {
+        return false;
+    }
+    return createArena(frameBytes);
+}
+
+size_t FramePoolAllocator::blockSize() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return block_size_;
+}
+
+size_t FramePoolAllocator::fallbacks() const {
+    return fallbacks_.load(std::memory_order_relaxed);
+}
+
+bool FramePoolAllocator::idle() const {
+    return free_blocks_.size() == block_count_;
+}
+
+void FramePoolAllocator::releaseArena() const {
+    if (arena_ != nullptr) {
+        munmap(arena_, arena_size_);
+    }
+    arena_ = nullptr;
+    arena_size_ = 0;
+    block_size_ = 0;
+    free_blocks_.clear();
+    free_headers_.clear();
+}
+
+bool FramePoolAllocator::createArena(size_t blockSize) const {
+    releaseArena();
+    block_size_ = cv::alignSize(blockSize, ALIGNMENT);
+    size_t length = block_size_ * block_count_;
+    if (huge_pages_) {
+        // Over-allocate so the arena itself can start on a huge page boundary
+        length += HUGE_PAGE_SIZE;
+    }
+
+    void *mapping = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapping == MAP_FAILED) {
+        // Left empty, so the next allocation tries again
+        perror("Failed to map frame pool");
+        block_size_ = 0;
+        return false;
+    }
+    arena_ = static_cast<unsigned char *>(mapping);
+    arena_size_ = length;
+
+    unsigned char *first = arena_;
+    if (huge_pages_) {
+        first = cv::alignPtr(arena_, static_cast<int>(HUGE_PAGE_SIZE));
+        if (madvise(first, block_size_ * block_count_, MADV_HUGEPAGE) != 0) {
+            perror("Failed to enable huge pages for frame pool");
+        }
+    }
+
+    // Fault every page in only now, after the huge page advice, so the
+    // capture loop never takes a page fault and the kernel can back the
+    // arena with huge pages instead of the 4 KiB pages MAP_POPULATE picks
+    size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    for (size_t offset = 0; offset < block_size_ * block_count_; offset += pageSize) {
+        first[offset] = 0;
+    }
+
+    // Headers are recycled too, so steady state performs no heap allocation
+    header_storage_.resize(sizeof(cv::UMatData) * block_count_ + alignof(cv::UMatData));
+    unsigned char *headers = reinterpret_cast<unsigned char *>(
+        cv::alignSize(reinterpret_cast<uintptr_t>(header_storage_.data()), alignof(cv::UMatData)));
+
+    free_blocks_.reserve(block_count_);
+    free_headers_.reserve(block_count_);
+    for (size_t i = 0; i < block_count_; i++) {
+        free_blocks_.push_back(first + i * block_size_);
+        free_headers_.push_back(reinterpret_cast<cv::UMatData *>(headers + i * sizeof(cv::UMatData)));
+    }
+
+    return true;
+}
+
+}  // namespace video
+}  // namespace teton
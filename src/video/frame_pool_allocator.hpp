@@ -0,0 +1,61 @@
+#ifndef __TETON_VIDEO_FRAME_POOL_ALLOCATOR_HPP__
+#define __TETON_VIDEO_FRAME_POOL_ALLOCATOR_HPP__
+
+#include <mutex>
+#include <atomic>
+#include <vector>
+#include <cstddef>
+#include <opencv2/core.hpp>
+
+namespace teton {
+namespace video {
+
+// cv::MatAllocator handing out buffers from a fixed pool of frame-sized blocks.
+//
+// The pool is carved out of a single pre-faulted mapping with every block
+// aligned to a cache line. Blocks are sized by reserve() from the source's
+// frame geometry, or after the first request when the geometry is unknown.
+// A larger request arriving while every block is free grows the pool. Mats
+// that do not fit, or that arrive while the pool is exhausted, fall back to
+// OpenCV's standard allocator.
+class FramePoolAllocator : public cv::MatAllocator {
+   public:
+    static const size_t ALIGNMENT = 64;
+
+    explicit FramePoolAllocator(size_t blockCount, bool hugePages = false);
+    ~FramePoolAllocator();
+
+    cv::UMatData *allocate(int dims, const int *sizes, int type, void *data, size_t *step,
+                           cv::AccessFlag flags, cv::UMatUsageFlags usageFlags) const override;
+    bool allocate(cv::UMatData *data, cv::AccessFlag accessflags, cv::UMatUsageFlags usageFlags) const override;
+    void deallocate(cv::UMatData *data) const override;
+
+    // Sizes the blocks for frames of frameBytes, ignored once blocks are in use
+    bool reserve(size_t frameBytes);
+
+    size_t blockSize() const;
+    size_t fallbacks() const;
+
+   private:
+    mutable std::mutex mutex_;
+    const size_t block_count_;
+    const bool huge_pages_;
+
+    // Created by reserve() or the first allocation
+    mutable unsigned char *arena_ = nullptr;
+    mutable size_t arena_size_ = 0;
+    mutable size_t block_size_ = 0;
+    mutable std::vector<unsigned char *> free_blocks_;
+    mutable std::vector<cv::UMatData *> free_headers_;
+    mutable std::vector<unsigned char> header_storage_;
+    mutable std::atomic<size_t> fallbacks_;
+
+    bool createArena(size_t blockSize) const;
+    void releaseArena() const;
+    bool idle() const;
+};
+
+}  // namespace video
+}  // namespace teton
+
+#endif
@@ -0,0 +1,131 @@
+#include "frame_source.hpp"
+
+#include <cstdio>
+
+#include "v4l2_capture.hpp"
+#include "frame_pool_allocator.hpp"
+#include "paced_source.hpp"
+#include "prefetch_source.hpp"
+#include "mapped_file_source.hpp"
+#include "shm_frame_source.hpp"
+#include "synthetic_source.hpp"
+#include "gstreamer_source.hpp"
+#include "latest_frame_source.hpp"
+#include "video_capture_source.hpp"
+
+namespace teton {
+namespace video {
+
+static bool hasPrefix(const std::string &input, const std::string &prefix) {
+    return input.compare(0, prefix.size(), prefix) == 0;
+}
+
+static bool hasSuffix(const std::string &input, const std::string &suffix) {
+    return input.size() >= suffix.size() && input.compare(input.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+bool DecoderOptions::valid() const {
+    // "all" is left out, as it discards every frame
+    static const char *levels[] = {"", "none", "default", "nonref", "bidir", "nonintra", "nonkey"};
+    for (const char *level : levels) {
+        if (skipFrame == level) {
+            return true;
+        }
+    }
+    return false;
+}
+
+const double DEFAULT_REPLAY_FPS = 30.0;
+
+// Recordings are paced to their native frame rate in real-time replays
+static std::unique_ptr<FrameSource> paceRecording(std::unique_ptr<FrameSource> source, const FrameSourceOptions &options) {
+    if (!source || options.replay != ReplayMode::RealTime) {
+        return source;
+    }
+
+    double fps = source->fps();
+    if (fps <= 0.0) {
+        fprintf(stderr, "Recording has no frame rate, replaying at %.0f fps\n", DEFAULT_REPLAY_FPS);
+        fps = DEFAULT_REPLAY_FPS;
+    }
+    return std::unique_ptr<FrameSource>(new PacedSource(std::move(source), fps));
+}
+
+// Sources decoding into the pool size it before their frames are read ahead
+static void reservePool(FramePoolAllocator *pool, const FrameSource &source) {
+    if (pool != nullptr && source.frameBytes() > 0) {
+        pool->reserve(source.frameBytes());
+    }
+}
+
+std::unique_ptr<FrameSource> FrameSource::create(const std::string &input, const FrameSourceOptions &options,
+                                                 FramePoolAllocator *pool) {
+    // Zero-copy device, driven directly by the event loop
+    if (hasPrefix(input, "v4l2:")) {
+        std::unique_ptr<V4L2Capture> source(new V4L2Capture(input.substr(5)));
+        if (!source->open()) {
+            return nullptr;
+        }
+        return std::unique_ptr<FrameSource>(std::move(source));
+    }
+
+    // Another local process already decodes the camera
+    if (hasPrefix(input, "shm:")) {
+        return std::unique_ptr<FrameSource>(new ShmFrameSource(input.substr(4)));
+    }
+
+    // Uncompressed recordings are mapped and never decoded
+    if (hasSuffix(input, ".y4m")) {
+        return paceRecording(std::unique_ptr<FrameSource>(MappedFileSource::openY4M(input)), options);
+    }
+    if (hasPrefix(input, "raw:")) {
+        char format[8] = {};
+        int width = 0, height = 0, pathStart = 0;
+        if (sscanf(input.c_str() + 4, "%7[a-z0-9]:%dx%d:%n", format, &width, &height, &pathStart) != 3 || pathStart == 0) {
+            fprintf(stderr, "Invalid raw input, expected raw:gray|nv12:WIDTHxHEIGHT:path\n");
+            return nullptr;
+        }
+        return paceRecording(std::unique_ptr<FrameSource>(
+            MappedFileSource::openRaw(input.substr(4 + pathStart), format, cv::Size(width, height))), options);
+    }
+
+    if (hasPrefix(input, "synthetic:")) {
+        int width = 0, height = 0;
+        if (sscanf(input.c_str() + 10, "%dx%d", &width, &height) != 2 || width <= 0 || height <= 0) {
+            fprintf(stderr, "Invalid synthetic input, expected synthetic:WIDTHxHEIGHT\n");
+            return nullptr;
+        }
+        std::unique_ptr<FrameSource> source(new SyntheticSource(cv::Size(width, height)));
+        reservePool(pool, *source);
+        return std::unique_ptr<FrameSource>(new PrefetchSource(std::move(source), pool));
+    }
+
+    // Scaling and conversion happen inside the pipeline, we only pull the newest buffer
+    // An explicit gst: prefix always wins, unprefixed inputs are recognized by their links
+    bool hasGstPrefix = hasPrefix(input, "gst:");
+    if (hasGstPrefix || input.find('!') != std::string::npos) {
+        std::unique_ptr<GStreamerSource> source(
+            new GStreamerSource(hasGstPrefix ? input.substr(4) : input, options.gstFormat, options.gstSize));
+        if (!source->open()) {
+            fprintf(stderr, "Failed to open GStreamer pipeline: %s\n", source->pipeline().c_str());
+            return nullptr;
+        }
+        reservePool(pool, *source);
+        return std::unique_ptr<FrameSource>(new LatestFrameSource(std::move(source), pool));
+    }
+
+    std::unique_ptr<VideoCaptureSource> source(new VideoCaptureSource(input, options.decoder));
+    if (!source->open()) {
+        return nullptr;
+    }
+    reservePool(pool, *source);
+
+    // Files are replayed without drops, live inputs always deliver the newest frame
+    if (source->isFile()) {
+        return paceRecording(std::unique_ptr<FrameSource>(new PrefetchSource(std::move(source), pool)), options);
+    }
+    return std::unique_ptr<FrameSource>(new LatestFrameSource(std::move(source), pool));
+}
+
+}  // namespace video
+}  // namespace teton
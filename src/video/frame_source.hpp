@@ -0,0 +1,99 @@
+#ifndef __TETON_VIDEO_FRAME_SOURCE_HPP__
+#define __TETON_VIDEO_FRAME_SOURCE_HPP__
+
+#include <memory>
+#include <string>
+#include <opencv2/core.hpp>
+
+namespace teton {
+namespace video {
+
+class FramePoolAllocator;
+
+// How recordings are fed to the processing loop
+enum class ReplayMode {
+    Unpaced,   // as fast as frames can be read, timing uses the wall clock
+    RealTime,  // paced to the recording's frame rate
+    Fast,      // as fast as possible, timing follows a virtual clock
+};
+
+// FFmpeg decoder threading and skipping for cv::VideoCapture inputs. Empty
+// values keep FFmpeg's defaults. OpenCV passes nothing else on to the decoder.
+struct DecoderOptions {
+    int threads = 0;         // 0 lets FFmpeg pick
+    std::string skipFrame;   // OpenCV's avdiscard level: "none", "default", "nonref", "bidir", "nonintra" or "nonkey"
+
+    bool empty() const { return threads == 0 && skipFrame.empty(); }
+
+    // False for a skip level OpenCV would silently ignore
+    bool valid() const;
+};
+
+// Settings applied to whichever source create() picks
+struct FrameSourceOptions {
+    // Caps negotiated at the end of GStreamer pipelines
+    std::string gstFormat = "GRAY8";
+    cv::Size gstSize;
+
+    // Only applies to recordings, live inputs are never paced
+    ReplayMode replay = ReplayMode::Unpaced;
+
+    DecoderOptions decoder;
+};
+
+// Where the processing loop obtains its frames from.
+//
+// Sources returned by create() expose a file descriptor that becomes readable
+// when a frame is ready, so they can be driven by the event loop. A frame
+// handed out by read() stays valid until release() or the next read().
+class FrameSource {
+   public:
+    virtual ~FrameSource() {}
+
+    // Non-blocking for sources that expose a file descriptor
+    virtual bool read(cv::Mat &frame) = 0;
+    virtual void release() {}
+
+    // False when the pixels of the last frame changed while it was being
+    // evaluated, which only happens for sources sharing memory with a writer
+    virtual bool intact() const { return true; }
+
+    // Readable when read() has a frame, -1 for sources that block in read()
+    virtual int fd() const { return -1; }
+
+    // True once read() will never deliver another frame, e.g. after the
+    // device was unplugged. The fd is dropped from the event loop then, as it
+    // may stay readable.
+    virtual bool ended() const { return false; }
+
+    // Nominal frame rate, 0 when unknown
+    virtual double fps() const { return 0.0; }
+
+    // Bytes of one frame as read() hands it out, 0 when only known once
+    // frames arrive
+    virtual size_t frameBytes() const { return 0; }
+
+    // False for recordings and generated frames, which end instead of
+    // stalling and are never reopened
+    virtual bool live() const { return true; }
+
+    // Opens the right source for a command line input:
+    //   v4l2:/dev/videoN              zero-copy V4L2 device
+    //   file.y4m                      mapped Y4M recording
+    //   raw:gray|nv12:WxH:path        mapped headerless recording
+    //   shm:/name                     frames shared by another local process
+    //   synthetic:WIDTHxHEIGHT        generated frames for benchmarks
+    //   0, 1, ...                     camera index
+    //   gst:... or "... ! ..."        GStreamer pipeline
+    //   anything else                 video file, decoded ahead of processing
+    //
+    // The pool is sized after the source's frames before any capture thread
+    // starts allocating from it.
+    static std::unique_ptr<FrameSource> create(const std::string &input, const FrameSourceOptions &options,
+                                               FramePoolAllocator *pool);
+};
+
+}  // namespace video
+}  // namespace teton
+
+#endif
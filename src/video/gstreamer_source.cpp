@@ -0,0 +1,54 @@
+#include "gstreamer_source.hpp"
+
+#include <vector>
+
+namespace teton {
+namespace video {
+
+GStreamerSource::GStreamerSource(const std::string &pipeline, const std::string &format, cv::Size size) :
+    pipeline_(pipeline),
+    format_(format) {
+    if (pipeline_.find("appsink") == std::string::npos) {
+        std::string caps = "video/x-raw,format=" + format_;
+        if (size.width > 0 && size.height > 0) {
+            caps += ",width=" + std::to_string(size.width) + ",height=" + std::to_string(size.height);
+        }
+        pipeline_ += " ! queue ! videoscale ! videoconvert ! " + caps + " ! appsink drop=true max-buffers=1 sync=false";
+    }
+}
+
+bool GStreamerSource::open() {
+    // Without this OpenCV converts every buffer to BGR on the streaming thread
+    std::vector<int> params = {cv::CAP_PROP_CONVERT_RGB, 0};
+    return cap_.open(pipeline_, cv::CAP_GSTREAMER, params);
+}
+
+bool GStreamerSource::read(cv::Mat &frame) {
+    if (format_ != "NV12") {
+        return cap_.read(frame) && !frame.empty();
+    }
+
+    // NV12 arrives as one plane of height * 3 / 2 rows. The frame is narrowed
+    // to the luma rows, the buffer stays owned by the caller's Mat.
+    if (!cap_.read(frame) || frame.empty()) {
+        return false;
+    }
+    frame = frame.rowRange(0, frame.rows * 2 / 3);
+    return true;
+}
+
+size_t GStreamerSource::frameBytes() const {
+    // NV12 buffers carry the chroma rows as well, anything else is unknown
+    size_t luma = static_cast<size_t>(cap_.get(cv::CAP_PROP_FRAME_WIDTH)) *
+                  static_cast<size_t>(cap_.get(cv::CAP_PROP_FRAME_HEIGHT));
+    if (format_ == "GRAY8") {
+        return luma;
+    }
+    if (format_ == "NV12") {
+        return luma * 3 / 2;
+    }
+    return 0;
+}
+
+}  // namespace video
+}  // namespace teton
@@ -0,0 +1,38 @@
+#ifndef __TETON_VIDEO_GSTREAMER_SOURCE_HPP__
+#define __TETON_VIDEO_GSTREAMER_SOURCE_HPP__
+
+#include <string>
+#include <opencv2/videoio.hpp>
+
+#include "frame_source.hpp"
+
+namespace teton {
+namespace video {
+
+// Frames pulled from a GStreamer pipeline through appsink.
+//
+// Pipelines that do not bring their own appsink get one appended, preceded by
+// a queue and scale/convert elements negotiating the requested format and
+// size. Decode, scaling and color conversion then run on GStreamer's
+// streaming threads and the appsink only keeps the newest buffer.
+class GStreamerSource : public FrameSource {
+   public:
+    // format is GRAY8 or NV12, an empty size keeps the source resolution
+    GStreamerSource(const std::string &pipeline, const std::string &format, cv::Size size);
+
+    bool open();
+    bool read(cv::Mat &frame) override;
+    size_t frameBytes() const override;
+
+    const std::string &pipeline() const { return pipeline_; }
+
+   private:
+    std::string pipeline_;
+    const std::string format_;
+    cv::VideoCapture cap_;
+};
+
+}  // namespace video
+}  // namespace teton
+
+#endif
@@ -0,0 +1,50 @@
+#include "latest_frame_source.hpp"
+
+#include <chrono>
+
+namespace teton {
+namespace video {
+
+LatestFrameSource::LatestFrameSource(std::unique_ptr<FrameSource> source, cv::MatAllocator *allocator) :
+    source_(std::move(source)),
+    fps_(source_->fps()),
+    allocator_(allocator),
+    running_(true) {
+    thread_ = std::thread(&LatestFrameSource::capture, this);
+}
+
+LatestFrameSource::~LatestFrameSource() {
+    running_ = false;
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+bool LatestFrameSource::read(cv::Mat &frame) {
+    frame_ready_.drain();
+    if (!frames_.fetch()) {
+        return false;
+    }
+    frame = frames_.readSlot();
+    return true;
+}
+
+void LatestFrameSource::capture() {
+    while (running_) {
+        // Decode straight into the slot we own, reusing its pixel buffer
+        cv::Mat &frame = frames_.writeSlot();
+        frame.allocator = allocator_;
+
+        // Back off briefly, the event loop decides when the camera is considered dead
+        if (!source_->read(frame)) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            continue;
+        }
+
+        frames_.publish();
+        frame_ready_.notify();
+    }
+}
+
+}  // namespace video
+}  // namespace teton
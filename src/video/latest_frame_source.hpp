@@ -0,0 +1,46 @@
+#ifndef __TETON_VIDEO_LATEST_FRAME_SOURCE_HPP__
+#define __TETON_VIDEO_LATEST_FRAME_SOURCE_HPP__
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <opencv2/core.hpp>
+
+#include "frame_source.hpp"
+#include "latest_mailbox.hpp"
+#include "../utils/event_loop.hpp"
+
+namespace teton {
+namespace video {
+
+// Reads a blocking live source on its own capture thread. Frames the
+// processing side did not get to in time are dropped, it always sees the
+// newest one.
+class LatestFrameSource : public FrameSource {
+   public:
+    LatestFrameSource(std::unique_ptr<FrameSource> source, cv::MatAllocator *allocator);
+    ~LatestFrameSource();
+
+    bool read(cv::Mat &frame) override;
+    int fd() const override { return frame_ready_.fd(); }
+    double fps() const override { return fps_; }
+
+    // Number of frames overwritten before they were read
+    size_t dropped() const { return frames_.dropped(); }
+
+   private:
+    std::unique_ptr<FrameSource> source_;
+    const double fps_;  // queried before the thread starts using the source
+    cv::MatAllocator *allocator_;
+    LatestMailbox<cv::Mat> frames_;
+    utils::EventFd frame_ready_;
+    std::atomic<bool> running_;
+    std::thread thread_;
+
+    void capture();
+};
+
+}  // namespace video
+}  // namespace teton
+
+#endif
@@ -0,0 +1,54 @@
+#include "latest_mailbox.hpp"
+
+namespace teton {
+namespace video {
+
+using namespace cv;
+
+template <class T>
+LatestMailbox<T>::LatestMailbox() :
+    shared_(2),
+    dropped_(0) {
+    // empty constructor
+}
+
+template <class T>
+T &LatestMailbox<T>::writeSlot() {
+    return slots_[write_];
+}
+
+template <class T>
+void LatestMailbox<T>::publish() {
+    // Hand our slot over and take back whatever the consumer left behind
+    uint8_t previous = shared_.exchange(write_ | FRESH, std::memory_order_acq_rel);
+    if (previous & FRESH) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+    }
+    write_ = previous & INDEX_MASK;
+}
+
+template <class T>
+bool LatestMailbox<T>::fetch() {
+    if (!(shared_.load(std::memory_order_relaxed) & FRESH)) {
+        return false;
+    }
+    uint8_t previous = shared_.exchange(read_, std::memory_order_acq_rel);
+    read_ = previous & INDEX_MASK;
+    return true;
+}
+
+template <class T>
+T &LatestMailbox<T>::readSlot() {
+    return slots_[read_];
+}
+
+template <class T>
+size_t LatestMailbox<T>::dropped() const {
+    return dropped_.load(std::memory_order_relaxed);
+}
+
+template class LatestMailbox<Mat>;
+template class LatestMailbox<std::pair<Mat, bool>>;
+
+}  // namespace video
+}  // namespace teton
@@ -0,0 +1,50 @@
+#ifndef __TETON_VIDEO_LATEST_MAILBOX_HPP__
+#define __TETON_VIDEO_LATEST_MAILBOX_HPP__
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+#include <opencv2/core.hpp>
+
+namespace teton {
+namespace video {
+
+// Single-producer/single-consumer slot where the latest item wins.
+//
+// Implemented as a triple buffer: the producer owns one slot, the consumer
+// owns another and the third is exchanged between them through a single
+// atomic. Both sides are wait-free and never copy the item, so a cv::Mat
+// keeps its pixel buffer and the decoder writes straight into it.
+template <class T>
+class LatestMailbox {
+   private:
+    // Set alongside the shared slot index when it holds an unseen item
+    static const uint8_t FRESH = 0x4;
+    static const uint8_t INDEX_MASK = 0x3;
+
+    T slots_[3];
+    std::atomic<uint8_t> shared_;
+    std::atomic<size_t> dropped_;
+    uint8_t write_ = 0;  // owned by the producer
+    uint8_t read_ = 1;   // owned by the consumer
+
+   public:
+    LatestMailbox();
+
+    // Producer side: fill writeSlot() then publish() it
+    T &writeSlot();
+    void publish();
+
+    // Consumer side: fetch() swaps in the newest item if there is one
+    bool fetch();
+    T &readSlot();
+
+    // Number of published items that were overwritten before being fetched
+    size_t dropped() const;
+};
+
+}  // namespace video
+}  // namespace teton
+
+#endif
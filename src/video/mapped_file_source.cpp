@@ -0,0 +1,197 @@
+#include "mapped_file_source.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace teton {
+namespace video {
+
+const char Y4M_MAGIC[] = "YUV4MPEG2 ";
+const char Y4M_FRAME[] = "FRAME";
+const long MAX_DIMENSION = 16384;
+
+// Frame dimensions must be the whole parameter, so "W64x" or "W" are rejected
+static bool parseDimension(const std::string &value, int &dimension) {
+    char *end = nullptr;
+    long parsed = strtol(value.c_str(), &end, 10);
+    if (end == value.c_str() || *end != '\0' || parsed <= 0 || parsed > MAX_DIMENSION) {
+        return false;
+    }
+    dimension = static_cast<int>(parsed);
+    return true;
+}
+
+MappedFileSource *MappedFileSource::openY4M(const std::string &path) {
+    std::unique_ptr<MappedFileSource> source(new MappedFileSource());
+    if (!source->map(path)) {
+        return nullptr;
+    }
+
+    const char *begin = reinterpret_cast<const char *>(source->data_);
+    const char *end = static_cast<const char *>(memchr(begin, '\n', source->length_));
+    if (end == nullptr || source->length_ < sizeof(Y4M_MAGIC) - 1 ||
+        memcmp(begin, Y4M_MAGIC, sizeof(Y4M_MAGIC) - 1) != 0) {
+        fprintf(stderr, "%s is not a Y4M file\n", path.c_str());
+        return nullptr;
+    }
+
+    // Header parameters are space separated, each tagged by its first letter
+    std::string header(begin, end);
+    std::string colorspace = "420";
+    size_t pos = 0;
+    while ((pos = header.find(' ', pos)) != std::string::npos) {
+        // Trailing spaces carry no parameter
+        if (++pos >= header.size()) {
+            break;
+        }
+        size_t next = header.find(' ', pos);
+        std::string value = header.substr(pos + 1, next == std::string::npos ? std::string::npos : next - pos - 1);
+        switch (header[pos]) {
+            case 'W':
+                if (!parseDimension(value, source->size_.width)) {
+                    fprintf(stderr, "Invalid Y4M width W%s in %s\n", value.c_str(), path.c_str());
+                    return nullptr;
+                }
+                break;
+            case 'H':
+                if (!parseDimension(value, source->size_.height)) {
+                    fprintf(stderr, "Invalid Y4M height H%s in %s\n", value.c_str(), path.c_str());
+                    return nullptr;
+                }
+                break;
+            case 'C':
+                colorspace = value;
+                break;
+            case 'F': {
+                int numerator = 0, denominator = 0;
+                if (sscanf(value.c_str(), "%d:%d", &numerator, &denominator) == 2 && denominator > 0) {
+                    source->fps_ = static_cast<double>(numerator) / denominator;
+                }
+                break;
+            }
+            default:
+                break;
+        }
+    }
+
+    // Only 8-bit layouts, the luma plane is handed out as CV_8UC1. High bit
+    // depths such as 420p10 or mono16 would be misread.
+    size_t lumaBytes = static_cast<size_t>(source->size_.area());
+    if (colorspace == "mono") {
+        source->frame_bytes_ = lumaBytes;
+    } else if (colorspace == "420" || colorspace == "420jpeg" || colorspace == "420mpeg2" || colorspace == "420paldv") {
+        source->frame_bytes_ = lumaBytes * 3 / 2;
+    } else if (colorspace == "422") {
+        source->frame_bytes_ = lumaBytes * 2;
+    } else if (colorspace == "444") {
+        source->frame_bytes_ = lumaBytes * 3;
+    } else {
+        fprintf(stderr, "Unsupported Y4M colorspace C%s in %s\n", colorspace.c_str(), path.c_str());
+        return nullptr;
+    }
+    if (lumaBytes == 0) {
+        fprintf(stderr, "Y4M header of %s has no frame size\n", path.c_str());
+        return nullptr;
+    }
+
+    source->y4m_ = true;
+    source->offset_ = static_cast<size_t>(end - begin) + 1;
+    return source.release();
+}
+
+MappedFileSource *MappedFileSource::openRaw(const std::string &path, const std::string &format, cv::Size size) {
+    std::unique_ptr<MappedFileSource> source(new MappedFileSource());
+    if (size.width <= 0 || size.height <= 0) {
+        fprintf(stderr, "Raw input %s needs a frame size\n", path.c_str());
+        return nullptr;
+    }
+    source->size_ = size;
+
+    size_t lumaBytes = static_cast<size_t>(size.area());
+    if (format == "gray") {
+        source->frame_bytes_ = lumaBytes;
+    } else if (format == "nv12") {
+        source->frame_bytes_ = lumaBytes * 3 / 2;
+    } else {
+        fprintf(stderr, "Unsupported raw format %s, expected gray or nv12\n", format.c_str());
+        return nullptr;
+    }
+
+    if (!source->map(path)) {
+        return nullptr;
+    }
+    return source.release();
+}
+
+MappedFileSource::MappedFileSource() {
+    frame_ready_.notify();
+}
+
+MappedFileSource::~MappedFileSource() {
+    if (data_ != nullptr) {
+        munmap(data_, length_);
+    }
+}
+
+bool MappedFileSource::read(cv::Mat &frame) {
+    size_t offset = offset_;
+    if (y4m_) {
+        // Every frame starts with a FRAME line, possibly carrying parameters
+        const char *line = reinterpret_cast<const char *>(data_ + offset);
+        const char *end = offset < length_ ? static_cast<const char *>(memchr(line, '\n', length_ - offset)) : nullptr;
+        if (end == nullptr || static_cast<size_t>(end - line) < sizeof(Y4M_FRAME) - 1 ||
+            memcmp(line, Y4M_FRAME, sizeof(Y4M_FRAME) - 1) != 0) {
+            ended_ = true;
+            return false;
+        }
+        offset += static_cast<size_t>(end - line) + 1;
+    }
+
+    if (offset + frame_bytes_ > length_) {
+        ended_ = true;
+        return false;
+    }
+
+    frame = cv::Mat(size_, CV_8UC1, data_ + offset);
+    offset_ = offset + frame_bytes_;
+    return true;
+}
+
+bool MappedFileSource::map(const std::string &path) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        perror(("Failed to open " + path).c_str());
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        fprintf(stderr, "%s is empty\n", path.c_str());
+        close(fd);
+        return false;
+    }
+
+    // Private and writable, so debug overlays never reach the file
+    void *mapping = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        perror(("Failed to map " + path).c_str());
+        return false;
+    }
+
+    data_ = static_cast<unsigned char *>(mapping);
+    length_ = static_cast<size_t>(st.st_size);
+
+    // Frames are consumed front to back, let the kernel read ahead aggressively
+    madvise(data_, length_, MADV_SEQUENTIAL);
+    madvise(data_, length_, MADV_WILLNEED);
+    return true;
+}
+
+}  // namespace video
+}  // namespace teton
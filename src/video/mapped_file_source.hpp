@@ -0,0 +1,53 @@
+#ifndef __TETON_VIDEO_MAPPED_FILE_SOURCE_HPP__
+#define __TETON_VIDEO_MAPPED_FILE_SOURCE_HPP__
+
+#include <string>
+#include <cstddef>
+#include <opencv2/core.hpp>
+
+#include "frame_source.hpp"
+#include "../utils/event_loop.hpp"
+
+namespace teton {
+namespace video {
+
+// Uncompressed Y4M or raw GRAY/NV12 recording mapped into memory.
+//
+// Frames are never decoded or copied: read() returns a Mat header pointing
+// at the luma plane inside the mapping. The mapping is private, so drawing
+// on a frame only copies the touched pages and never modifies the file.
+class MappedFileSource : public FrameSource {
+   public:
+    // Parses the stream header of a .y4m file
+    static MappedFileSource *openY4M(const std::string &path);
+    // Raw files carry no header, format is "gray" or "nv12"
+    static MappedFileSource *openRaw(const std::string &path, const std::string &format, cv::Size size);
+
+    ~MappedFileSource();
+
+    bool read(cv::Mat &frame) override;
+    int fd() const override { return frame_ready_.fd(); }
+    double fps() const override { return fps_; }
+    bool live() const override { return false; }
+    bool ended() const override { return ended_; }
+
+   private:
+    MappedFileSource();
+
+    bool map(const std::string &path);
+
+    unsigned char *data_ = nullptr;
+    size_t length_ = 0;
+    size_t offset_ = 0;          // start of the next frame, including its header
+    bool y4m_ = false;           // frames are preceded by a FRAME line
+    cv::Size size_;
+    size_t frame_bytes_ = 0;     // all planes of one frame
+    double fps_ = 0.0;           // only known for Y4M
+    bool ended_ = false;
+    utils::EventFd frame_ready_;  // always readable, the end is reported by ended()
+};
+
+}  // namespace video
+}  // namespace teton
+
+#endif
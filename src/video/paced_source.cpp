@@ -0,0 +1,68 @@
+#include "paced_source.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <unistd.h>
+#include <sys/epoll.h>
+
+namespace teton {
+namespace video {
+
+PacedSource::PacedSource(std::unique_ptr<FrameSource> source, double fps) :
+    source_(std::move(source)),
+    fps_(fps),
+    epoll_fd_(epoll_create1(EPOLL_CLOEXEC)) {
+    if (epoll_fd_ < 0) {
+        perror("Failed to create epoll instance for pacing");
+    }
+    epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.fd = timer_.fd();
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, timer_.fd(), &event) != 0) {
+        perror("Failed to watch pacing timer");
+    }
+
+    auto period = std::chrono::nanoseconds(static_cast<long long>(1e9 / fps_));
+    timer_.arm(period, period);
+}
+
+PacedSource::~PacedSource() {
+    if (epoll_fd_ >= 0) {
+        close(epoll_fd_);
+    }
+}
+
+bool PacedSource::read(cv::Mat &frame) {
+    // A tick that finds no frame ready means decode fell behind real time,
+    // the frame is then released as soon as it was decoded
+    owed_ += timer_.drain();
+    if (owed_ == 0) {
+        return false;
+    }
+
+    bool decoded = source_->read(frame);
+    if (decoded) {
+        owed_--;
+    }
+    watchSource(owed_ > 0);
+    return decoded;
+}
+
+void PacedSource::watchSource(bool watch) {
+    int fd = source_->fd();
+    if (fd < 0 || watch == watching_source_) {
+        return;
+    }
+
+    epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.fd = fd;
+    if (epoll_ctl(epoll_fd_, watch ? EPOLL_CTL_ADD : EPOLL_CTL_DEL, fd, &event) != 0) {
+        perror("Failed to watch paced source");
+        return;
+    }
+    watching_source_ = watch;
+}
+
+}  // namespace video
+}  // namespace teton
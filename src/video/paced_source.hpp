@@ -0,0 +1,47 @@
+#ifndef __TETON_VIDEO_PACED_SOURCE_HPP__
+#define __TETON_VIDEO_PACED_SOURCE_HPP__
+
+#include <memory>
+#include <cstdint>
+#include <opencv2/core.hpp>
+
+#include "frame_source.hpp"
+#include "../utils/event_loop.hpp"
+
+namespace teton {
+namespace video {
+
+// Releases the frames of a recording at its native frame rate, so a replay
+// exercises the same timing as the camera it was recorded from.
+//
+// Ticks that find no frame ready are owed and paid back as soon as decode
+// catches up. fd() is an epoll instance watching the timer, and the wrapped
+// source as well while frames are owed.
+class PacedSource : public FrameSource {
+   public:
+    PacedSource(std::unique_ptr<FrameSource> source, double fps);
+    ~PacedSource();
+
+    bool read(cv::Mat &frame) override;
+    void release() override { source_->release(); }
+    bool intact() const override { return source_->intact(); }
+    int fd() const override { return epoll_fd_; }
+    bool ended() const override { return source_->ended(); }
+    double fps() const override { return fps_; }
+    bool live() const override { return source_->live(); }
+
+   private:
+    std::unique_ptr<FrameSource> source_;
+    const double fps_;
+    utils::TimerFd timer_;
+    int epoll_fd_ = -1;
+    uint64_t owed_ = 0;
+    bool watching_source_ = false;
+
+    void watchSource(bool watch);
+};
+
+}  // namespace video
+}  // namespace teton
+
+#endif
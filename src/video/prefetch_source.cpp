@@ -0,0 +1,96 @@
+#include "prefetch_source.hpp"
+
+#include <chrono>
+
+namespace teton {
+namespace video {
+
+PrefetchSource::PrefetchSource(std::unique_ptr<FrameSource> source, cv::MatAllocator *allocator, size_t depth) :
+    source_(std::move(source)),
+    fps_(source_->fps()),
+    depth_(depth),
+    frame_ready_(true) {
+    // One buffer per queued frame, plus the one in decode and the one handed out
+    free_.resize(depth_ + 1);
+    for (auto &frame : free_) {
+        frame.allocator = allocator;
+    }
+    thread_ = std::thread(&PrefetchSource::decode, this);
+}
+
+PrefetchSource::~PrefetchSource() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = false;
+    }
+    space_available_.notify_one();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+bool PrefetchSource::read(cv::Mat &frame) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (ready_.empty()) {
+        return false;
+    }
+
+    // Hand the previous frame's buffer back for decoding
+    if (holding_) {
+        free_.push_back(current_);
+    }
+    current_ = ready_.front();
+    holding_ = true;
+    ready_.pop_front();
+    frame_ready_.drain();
+    space_available_.notify_one();
+
+    frame = current_;
+    return true;
+}
+
+bool PrefetchSource::ended() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return end_of_stream_ && ready_.empty();
+}
+
+void PrefetchSource::decode() {
+    while (true) {
+        cv::Mat frame;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            space_available_.wait(lock, [this]() { return !running_ || (ready_.size() < depth_ && !free_.empty()); });
+            if (!running_) {
+                return;
+            }
+            frame = free_.back();
+            free_.pop_back();
+        }
+
+        // Decode outside the lock while the processing side works on earlier frames
+        bool decoded = source_->read(frame);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (decoded) {
+                ready_.push_back(frame);
+                frame_ready_.notify();
+                continue;
+            }
+            free_.push_back(frame);
+
+            // Recordings do not resume, wake the event loop once more so it
+            // sees the end right after the last frame
+            if (!source_->live() || source_->ended()) {
+                end_of_stream_ = true;
+                frame_ready_.notify();
+                return;
+            }
+        }
+
+        // Back off briefly, the event loop decides when the input is considered dead
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+}
+
+}  // namespace video
+}  // namespace teton
@@ -0,0 +1,57 @@
+#ifndef __TETON_VIDEO_PREFETCH_SOURCE_HPP__
+#define __TETON_VIDEO_PREFETCH_SOURCE_HPP__
+
+#include <deque>
+#include <mutex>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <condition_variable>
+#include <opencv2/core.hpp>
+
+#include "frame_source.hpp"
+#include "../utils/event_loop.hpp"
+
+namespace teton {
+namespace video {
+
+// Decodes up to `depth` frames ahead of the processing side on its own
+// thread, so frame N+1 is decoded while frame N is evaluated. Unlike
+// LatestFrameSource no frame is ever dropped, which is what replays want.
+class PrefetchSource : public FrameSource {
+   public:
+    PrefetchSource(std::unique_ptr<FrameSource> source, cv::MatAllocator *allocator, size_t depth = 4);
+    ~PrefetchSource();
+
+    bool read(cv::Mat &frame) override;
+    int fd() const override { return frame_ready_.fd(); }
+    double fps() const override { return fps_; }
+    bool live() const override { return source_->live(); }
+
+    // The recording ended and every decoded frame was read
+    bool ended() const override;
+
+   private:
+    std::unique_ptr<FrameSource> source_;
+    const double fps_;  // queried before the thread starts using the source
+    const size_t depth_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable space_available_;
+    std::deque<cv::Mat> ready_;
+    std::vector<cv::Mat> free_;  // recycled buffers, so decoding never allocates
+    cv::Mat current_;            // frame handed out by the last read()
+    bool holding_ = false;
+    bool end_of_stream_ = false;  // set by the decode thread, which then exits
+
+    utils::EventFd frame_ready_;
+    bool running_ = true;
+    std::thread thread_;
+
+    void decode();
+};
+
+}  // namespace video
+}  // namespace teton
+
+#endif
@@ -0,0 +1,189 @@
+#include "shm_frame_source.hpp"
+
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace teton {
+namespace video {
+
+using network::ShmRingHeader;
+using network::ShmSlotHeader;
+
+const auto SHM_POLL_PERIOD = std::chrono::milliseconds(5);
+// About one second without frames before checking for a new writer
+const unsigned int SHM_REPLACED_CHECK_POLLS = 200;
+
+ShmFrameSource::ShmFrameSource(const std::string &name) :
+    name_(name) {
+    poll_timer_.arm(SHM_POLL_PERIOD, SHM_POLL_PERIOD);
+}
+
+ShmFrameSource::~ShmFrameSource() {
+    detach();
+}
+
+bool ShmFrameSource::read(cv::Mat &frame) {
+    poll_timer_.drain();
+
+    // The writer may start after us, keep trying until its ring shows up
+    if (mapping_ == nullptr && !attach()) {
+        return false;
+    }
+
+    const ShmRingHeader *ring = reinterpret_cast<const ShmRingHeader *>(mapping_);
+    if (ring->closed.load(std::memory_order_acquire) != 0) {
+        printf("Shared memory frame ring %s was closed\n", name_.c_str());
+        detach();
+        return false;
+    }
+
+    // A writer that crashed never closes its ring, the next one replaces it
+    uint64_t head = ring->head.load(std::memory_order_acquire);
+    if (head == 0 || head <= next_) {
+        if (++idle_polls_ >= SHM_REPLACED_CHECK_POLLS) {
+            idle_polls_ = 0;
+            if (replaced()) {
+                printf("Shared memory frame ring %s was replaced\n", name_.c_str());
+                detach();
+            }
+        }
+        return false;
+    }
+    idle_polls_ = 0;
+
+    // Only the newest frame matters, everything between it and the last one we read is skipped
+    uint64_t index = head - 1;
+    const unsigned char *slotStart = mapping_ + sizeof(ShmRingHeader) + (index % slot_count_) * network::shmSlotStride(slot_bytes_);
+    const ShmSlotHeader *slot = reinterpret_cast<const ShmSlotHeader *>(slotStart);
+
+    uint64_t sequence = slot->sequence.load(std::memory_order_acquire);
+    if (sequence != 2 * index + 2) {
+        // Already being overwritten by a newer frame, pick that one up next time
+        lapped_++;
+        return false;
+    }
+
+    // The geometry is only trusted once the sequence confirms it was not
+    // rewritten while we copied it
+    int rows = slot->rows;
+    int cols = slot->cols;
+    int type = slot->type;
+    size_t step = slot->step;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot->sequence.load(std::memory_order_relaxed) != sequence) {
+        lapped_++;
+        return false;
+    }
+
+    // Never let a broken or hostile writer point us outside the slot
+    if (!validGeometry(rows, cols, type, step)) {
+        fprintf(stderr, "Discarding frame with invalid geometry %dx%d type %d step %zu from %s\n", cols, rows, type, step,
+                name_.c_str());
+        next_ = head;
+        return false;
+    }
+
+    slot_ = slot;
+    sequence_ = sequence;
+    next_ = head;
+    frame = cv::Mat(rows, cols, type, const_cast<unsigned char *>(slotStart + sizeof(ShmSlotHeader)), step);
+    return true;
+}
+
+bool ShmFrameSource::validGeometry(int rows, int cols, int type, size_t step) const {
+    // Frames are evaluated as 8-bit images, other depths would be misread
+    if ((type != CV_8UC1 && type != CV_8UC2 && type != CV_8UC3 && type != CV_8UC4) || rows <= 0 || cols <= 0) {
+        return false;
+    }
+    size_t rowBytes = static_cast<size_t>(cols) * CV_ELEM_SIZE(type);
+    return rowBytes <= step && static_cast<size_t>(rows) * step <= slot_bytes_;
+}
+
+bool ShmFrameSource::intact() const {
+    if (slot_ == nullptr) {
+        return true;
+    }
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot_->sequence.load(std::memory_order_relaxed) != sequence_) {
+        lapped_++;
+        return false;
+    }
+    return true;
+}
+
+bool ShmFrameSource::attach() {
+    int fd = shm_open(name_.c_str(), O_RDONLY, 0);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(ShmRingHeader)) {
+        close(fd);
+        return false;
+    }
+
+    void *mapping = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        perror(("Failed to map shared memory " + name_).c_str());
+        return false;
+    }
+
+    // A ring without magic is still being set up by the writer
+    const ShmRingHeader *ring = static_cast<const ShmRingHeader *>(mapping);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (ring->magic != ShmRingHeader::MAGIC || ring->version != ShmRingHeader::VERSION || ring->slotCount == 0 ||
+        network::shmRingSize(ring->slotCount, ring->slotBytes) > static_cast<size_t>(st.st_size)) {
+        munmap(mapping, static_cast<size_t>(st.st_size));
+        return false;
+    }
+
+    // A closed ring is about to be unlinked, wait for the next writer
+    if (ring->closed.load(std::memory_order_acquire) != 0) {
+        munmap(mapping, static_cast<size_t>(st.st_size));
+        return false;
+    }
+
+    // Copied once, so a writer changing them later cannot move slots past the mapping
+    slot_count_ = ring->slotCount;
+    slot_bytes_ = ring->slotBytes;
+    mapping_ = static_cast<const unsigned char *>(mapping);
+    length_ = static_cast<size_t>(st.st_size);
+    device_ = st.st_dev;
+    inode_ = st.st_ino;
+    idle_polls_ = 0;
+    printf("Attached to shared memory frame ring %s\n", name_.c_str());
+    return true;
+}
+
+void ShmFrameSource::detach() {
+    if (mapping_ != nullptr) {
+        munmap(const_cast<unsigned char *>(mapping_), length_);
+    }
+    mapping_ = nullptr;
+    length_ = 0;
+    slot_ = nullptr;
+    next_ = 0;
+}
+
+bool ShmFrameSource::replaced() const {
+    int fd = shm_open(name_.c_str(), O_RDONLY, 0);
+    if (fd < 0) {
+        return errno == ENOENT;
+    }
+
+    struct stat st;
+    bool replaced = fstat(fd, &st) == 0 && (st.st_dev != device_ || st.st_ino != inode_);
+    close(fd);
+    return replaced;
+}
+
+}  // namespace video
+}  // namespace teton
@@ -0,0 +1,62 @@
+#ifndef __TETON_VIDEO_SHM_FRAME_SOURCE_HPP__
+#define __TETON_VIDEO_SHM_FRAME_SOURCE_HPP__
+
+#include <string>
+#include <cstdint>
+#include <sys/types.h>
+#include <opencv2/core.hpp>
+
+#include "frame_source.hpp"
+#include "../utils/event_loop.hpp"
+#include "../network/shm_frame_ring.hpp"
+
+namespace teton {
+namespace video {
+
+// Frames read from a shared-memory frame ring published by another local
+// process, so this node never opens or decodes the camera itself.
+//
+// The ring is mapped read-only and frames are evaluated directly on the
+// shared pixels. A writer that laps the reader while a frame is evaluated is
+// detected through the slot's sequence number, see intact(). When the writer
+// closes its ring or a new writer replaces it, the ring is attached again.
+class ShmFrameSource : public FrameSource {
+   public:
+    explicit ShmFrameSource(const std::string &name);
+    ~ShmFrameSource();
+
+    bool read(cv::Mat &frame) override;
+    bool intact() const override;
+
+    // The writer cannot wake us up across processes, so the ring is polled
+    int fd() const override { return poll_timer_.fd(); }
+
+    // Frames overwritten before or while they were read
+    uint64_t lapped() const { return lapped_; }
+
+   private:
+    const std::string name_;
+    const unsigned char *mapping_ = nullptr;
+    size_t length_ = 0;
+    uint32_t slot_count_ = 0;
+    uint32_t slot_bytes_ = 0;
+    dev_t device_ = 0;  // identity of the attached object, to notice replacements
+    ino_t inode_ = 0;
+    utils::TimerFd poll_timer_;
+    unsigned int idle_polls_ = 0;
+
+    const network::ShmSlotHeader *slot_ = nullptr;  // slot of the frame handed out last
+    uint64_t sequence_ = 0;                         // its sequence when it was handed out
+    uint64_t next_ = 0;                             // first frame not read yet
+    mutable uint64_t lapped_ = 0;
+
+    bool attach();
+    bool validGeometry(int rows, int cols, int type, size_t step) const;
+    void detach();
+    bool replaced() const;
+};
+
+}  // namespace video
+}  // namespace teton
+
+#endif
@@ -0,0 +1,103 @@
+#include "source_reopener.hpp"
+
+#include <mutex>
+#include <chrono>
+#include <cstdio>
+#include <condition_variable>
+
+namespace teton {
+namespace video {
+
+// How long destruction waits for a hung attempt before leaving it behind
+const auto SHUTDOWN_WAIT = std::chrono::seconds(2);
+
+// Shared with the thread, which may outlive the reopener when a device hangs
+// at shutdown. The thread only touches this state and what it owns itself.
+struct SourceReopener::Attempt {
+    std::mutex mutex;
+    std::condition_variable finished;
+    bool busy = false;
+    bool cancelled = false;  // nobody takes the result any more
+    std::unique_ptr<FrameSource> result;
+    utils::EventFd done;
+};
+
+SourceReopener::SourceReopener() :
+    attempt_(std::make_shared<Attempt>()) {
+    // empty constructor
+}
+
+SourceReopener::~SourceReopener() {
+    if (!thread_.joinable()) {
+        return;
+    }
+
+    bool finished;
+    {
+        std::unique_lock<std::mutex> lock(attempt_->mutex);
+        attempt_->cancelled = true;
+        finished = attempt_->finished.wait_for(lock, SHUTDOWN_WAIT, [this]() { return !attempt_->busy; });
+    }
+    if (finished) {
+        thread_.join();
+        return;
+    }
+
+    // Safe to leave running: the thread co-owns the attempt and the frame
+    // pool, and discards whatever it opens
+    fprintf(stderr, "Source is still reopening, not waiting for it\n");
+    thread_.detach();
+}
+
+bool SourceReopener::start(std::unique_ptr<FrameSource> stalled, const std::string &input,
+                           const FrameSourceOptions &options, std::shared_ptr<FramePoolAllocator> pool) {
+    if (busy()) {
+        return false;
+    }
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+
+    std::shared_ptr<Attempt> attempt = attempt_;
+    {
+        std::lock_guard<std::mutex> lock(attempt->mutex);
+        attempt->busy = true;
+    }
+
+    // std::thread cannot take move-only arguments by value in C++11
+    FrameSource *old = stalled.release();
+    thread_ = std::thread([attempt, old, input, options, pool]() {
+        // Closing can block as long as opening, e.g. joining a capture thread stuck in read
+        delete old;
+        std::unique_ptr<FrameSource> source = FrameSource::create(input, options, pool.get());
+
+        std::lock_guard<std::mutex> lock(attempt->mutex);
+        if (attempt->cancelled) {
+            // Closed here, while our reference still keeps its frame pool alive
+            source.reset();
+        }
+        attempt->result = std::move(source);
+        attempt->busy = false;
+        attempt->done.notify();
+        attempt->finished.notify_all();
+    });
+    return true;
+}
+
+std::unique_ptr<FrameSource> SourceReopener::take() {
+    std::lock_guard<std::mutex> lock(attempt_->mutex);
+    attempt_->done.drain();
+    return std::move(attempt_->result);
+}
+
+bool SourceReopener::busy() const {
+    std::lock_guard<std::mutex> lock(attempt_->mutex);
+    return attempt_->busy;
+}
+
+int SourceReopener::fd() const {
+    return attempt_->done.fd();
+}
+
+}  // namespace video
+}  // namespace teton
@@ -0,0 +1,43 @@
+#ifndef __TETON_VIDEO_SOURCE_REOPENER_HPP__
+#define __TETON_VIDEO_SOURCE_REOPENER_HPP__
+
+#include <memory>
+#include <string>
+#include <thread>
+#include <opencv2/core.hpp>
+
+#include "frame_source.hpp"
+#include "../utils/event_loop.hpp"
+
+namespace teton {
+namespace video {
+
+// Closes a stalled source and opens its input again on a background thread,
+// so closing a hung device and renegotiating the camera never block the
+// event loop. fd() becomes readable once the attempt completed.
+class SourceReopener {
+   public:
+    SourceReopener();
+    ~SourceReopener();
+
+    // Takes ownership of the stalled source, ignored while busy. The pool is
+    // shared because a hung attempt may outlive the reopener.
+    bool start(std::unique_ptr<FrameSource> stalled, const std::string &input, const FrameSourceOptions &options,
+               std::shared_ptr<FramePoolAllocator> pool);
+
+    // Reopened source, nullptr when opening failed
+    std::unique_ptr<FrameSource> take();
+
+    bool busy() const;
+    int fd() const;
+
+   private:
+    struct Attempt;
+    std::shared_ptr<Attempt> attempt_;
+    std::thread thread_;
+};
+
+}  // namespace video
+}  // namespace teton
+
+#endif
@@ -0,0 +1,62 @@
+#include "stall_watchdog.hpp"
+
+#include <algorithm>
+
+namespace teton {
+namespace video {
+
+const double DEFAULT_WATCHDOG_FPS = 30.0;
+
+// Exposure changes and USB hiccups routinely cost a few frames
+const StallWatchdog::clock::duration MIN_STALL_TIME = std::chrono::milliseconds(500);
+
+// Caps the exponential backoff at 16 stall periods
+const int MAX_BACKOFF_SHIFT = 4;
+
+StallWatchdog::StallWatchdog(double fps, clock::duration giveUpAfter, bool recoverable,
+                             int missedFrames, int reopenAttempts) :
+    mGiveUpAfter(giveUpAfter),
+    mRecoverable(recoverable),
+    mReopenAttempts(reopenAttempts),
+    mAttempts(0) {
+    if (fps <= 0.0) {
+        fps = DEFAULT_WATCHDOG_FPS;
+    }
+    clock::duration framePeriod = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(1.0 / fps));
+    mStallAfter = std::max(framePeriod * missedFrames, MIN_STALL_TIME);
+    frameArrived(clock::now());
+}
+
+void StallWatchdog::frameArrived(clock::time_point now) {
+    mLastFrame = now;
+    mNextAttempt = now + mStallAfter;
+    mAttempts = 0;
+}
+
+Recovery StallWatchdog::escalate(clock::time_point now) {
+    if (!mRecoverable || now < mNextAttempt) {
+        return Recovery::None;
+    }
+
+    // Pushed again by recoveryFinished() once the attempt completed
+    mAttempts++;
+    mNextAttempt = now + mStallAfter * (1 << std::min(mAttempts, MAX_BACKOFF_SHIFT));
+    return mAttempts <= mReopenAttempts ? Recovery::Reopen : Recovery::ResetBackend;
+}
+
+void StallWatchdog::recoveryFinished(clock::time_point now) {
+    mNextAttempt = now + mStallAfter * (1 << std::min(mAttempts, MAX_BACKOFF_SHIFT));
+}
+
+bool StallWatchdog::expired(clock::time_point now) const {
+    if (gap(now) < mGiveUpAfter) {
+        return false;
+    }
+
+    // Attempts that hang do not keep the node alive forever
+    bool escalated = !mRecoverable || mAttempts > mReopenAttempts;
+    return escalated || gap(now) >= 2 * mGiveUpAfter;
+}
+
+}  // namespace video
+}  // namespace teton
@@ -0,0 +1,55 @@
+#ifndef __TETON_VIDEO_STALL_WATCHDOG_HPP__
+#define __TETON_VIDEO_STALL_WATCHDOG_HPP__
+
+#include <chrono>
+
+namespace teton {
+namespace video {
+
+// What the processing loop should do about a stalled source
+enum class Recovery {
+    None,
+    Reopen,        // open the same input again
+    ResetBackend,  // open it again with default decoder options
+};
+
+// Tracks the gaps between frames against the source's frame rate and
+// escalates a stall in tiers: a few missed frames trigger reopens, repeated
+// failures a backend reset, and only once both were tried and nothing
+// arrived for `giveUpAfter` is the source considered dead. Retries back off
+// exponentially.
+class StallWatchdog {
+   public:
+    typedef std::chrono::steady_clock clock;
+
+    StallWatchdog(double fps, clock::duration giveUpAfter, bool recoverable,
+                  int missedFrames = 5, int reopenAttempts = 2);
+
+    void frameArrived(clock::time_point now);
+
+    // Next recovery step, None while the current attempt still has time
+    Recovery escalate(clock::time_point now);
+
+    // A recovery attempt completed, successful or not
+    void recoveryFinished(clock::time_point now);
+
+    // True once recovery was exhausted
+    bool expired(clock::time_point now) const;
+
+    clock::duration gap(clock::time_point now) const { return now - mLastFrame; }
+    int attempts() const { return mAttempts; }
+
+   private:
+    clock::duration mStallAfter;
+    clock::duration mGiveUpAfter;
+    bool mRecoverable;
+    int mReopenAttempts;
+    int mAttempts;
+    clock::time_point mLastFrame;
+    clock::time_point mNextAttempt;
+};
+
+}  // namespace video
+}  // namespace teton
+
+#endif
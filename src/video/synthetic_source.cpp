@@ -0,0 +1,26 @@
+#include "synthetic_source.hpp"
+
+#include <cstdlib>
+
+namespace teton {
+namespace video {
+
+SyntheticSource::SyntheticSource(cv::Size size, int period) :
+    size_(size),
+    period_(period) {
+    // empty constructor
+}
+
+bool SyntheticSource::read(cv::Mat &frame) {
+    // Triangle wave over one period
+    int phase = index_ % period_;
+    int level = 255 - std::abs(2 * 255 * phase / period_ - 255);
+    index_++;
+
+    frame.create(size_, CV_8UC1);
+    frame.setTo(cv::Scalar(level));
+    return true;
+}
+
+}  // namespace video
+}  // namespace teton
@@ -0,0 +1,30 @@
+#ifndef __TETON_VIDEO_SYNTHETIC_SOURCE_HPP__
+#define __TETON_VIDEO_SYNTHETIC_SOURCE_HPP__
+
+#include <opencv2/core.hpp>
+
+#include "frame_source.hpp"
+
+namespace teton {
+namespace video {
+
+// Generated grayscale frames whose brightness sweeps from dark to bright and
+// back, so benchmarks exercise both LED states without any decode cost
+class SyntheticSource : public FrameSource {
+   public:
+    SyntheticSource(cv::Size size, int period = 256);
+
+    bool read(cv::Mat &frame) override;
+    bool live() const override { return false; }
+    size_t frameBytes() const override { return size_.area(); }
+
+   private:
+    const cv::Size size_;
+    const int period_;
+    int index_ = 0;
+};
+
+}  // namespace video
+}  // namespace teton
+
+#endif
@@ -0,0 +1,243 @@
+#include "v4l2_capture.hpp"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/ioctl.h>
+#include <linux/videodev2.h>
+#include <opencv2/imgproc.hpp>
+
+namespace teton {
+namespace video {
+
+// Formats we can evaluate without conversion, in order of preference
+const uint32_t PREFERRED_FORMATS[] = {V4L2_PIX_FMT_GREY, V4L2_PIX_FMT_NV12, V4L2_PIX_FMT_YUYV};
+
+static int xioctl(int fd, unsigned long request, void *arg) {
+    int result;
+    do {
+        result = ioctl(fd, request, arg);
+    } while (result == -1 && errno == EINTR);
+    return result;
+}
+
+V4L2Capture::V4L2Capture(const std::string &device, unsigned int bufferCount) :
+    device_(device),
+    buffer_count_(bufferCount) {
+    // empty constructor
+}
+
+V4L2Capture::~V4L2Capture() {
+    close();
+}
+
+bool V4L2Capture::open(int width, int height) {
+    fd_ = ::open(device_.c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+    if (fd_ < 0) {
+        perror(("Failed to open " + device_).c_str());
+        return false;
+    }
+
+    v4l2_capability cap = {};
+    if (xioctl(fd_, VIDIOC_QUERYCAP, &cap) != 0) {
+        perror("VIDIOC_QUERYCAP");
+        close();
+        return false;
+    }
+    uint32_t caps = (cap.capabilities & V4L2_CAP_DEVICE_CAPS) ? cap.device_caps : cap.capabilities;
+    if (!(caps & V4L2_CAP_VIDEO_CAPTURE) || !(caps & V4L2_CAP_STREAMING)) {
+        fprintf(stderr, "%s does not support streaming video capture\n", device_.c_str());
+        close();
+        return false;
+    }
+
+    if (!negotiateFormat(width, height) || !mapBuffers()) {
+        close();
+        return false;
+    }
+
+    v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    if (xioctl(fd_, VIDIOC_STREAMON, &type) != 0) {
+        perror("VIDIOC_STREAMON");
+        close();
+        return false;
+    }
+    streaming_ = true;
+
+    return true;
+}
+
+void V4L2Capture::close() {
+    if (fd_ < 0) {
+        return;
+    }
+
+    if (streaming_) {
+        v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        xioctl(fd_, VIDIOC_STREAMOFF, &type);
+        streaming_ = false;
+    }
+
+    for (auto &buffer : buffers_) {
+        munmap(buffer.start, buffer.length);
+    }
+    buffers_.clear();
+    held_ = -1;
+    failed_ = false;
+
+    // Release the driver side of the buffers as well
+    v4l2_requestbuffers req = {};
+    req.count = 0;
+    req.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    req.memory = V4L2_MEMORY_MMAP;
+    xioctl(fd_, VIDIOC_REQBUFS, &req);
+
+    ::close(fd_);
+    fd_ = -1;
+}
+
+bool V4L2Capture::isOpened() const {
+    return streaming_;
+}
+
+bool V4L2Capture::read(cv::Mat &frame) {
+    bool dequeued = false;
+    while (dequeue(frame)) {
+        dequeued = true;
+    }
+
+    // Only the buffer handed out is converted, skipped ones go back untouched
+    if (dequeued && pixel_format_ == V4L2_PIX_FMT_YUYV) {
+        cv::cvtColor(frame, luma_, cv::COLOR_YUV2GRAY_YUYV);
+        requeue();
+        frame = luma_;
+    }
+    return dequeued;
+}
+
+void V4L2Capture::release() {
+    requeue();
+}
+
+bool V4L2Capture::dequeue(cv::Mat &view) {
+    if (failed_) {
+        return false;
+    }
+
+    v4l2_buffer buf = {};
+    buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    buf.memory = V4L2_MEMORY_MMAP;
+    if (xioctl(fd_, VIDIOC_DQBUF, &buf) != 0) {
+        // Anything but an empty queue, e.g. ENODEV after an unplug, repeats
+        // on every attempt while the fd keeps polling readable
+        if (errno != EAGAIN) {
+            perror("VIDIOC_DQBUF");
+            failed_ = true;
+        }
+        return false;
+    }
+
+    // Only one buffer is held at a time, so a newer frame releases the older one
+    requeue();
+    held_ = static_cast<int>(buf.index);
+
+    // Wrap the driver memory, the Mat header does not own it
+    unsigned char *data = static_cast<unsigned char *>(buffers_[buf.index].start);
+    if (pixel_format_ == V4L2_PIX_FMT_YUYV) {
+        view = cv::Mat(height_, width_, CV_8UC2, data, bytes_per_line_);
+    } else {
+        view = cv::Mat(height_, width_, CV_8UC1, data, bytes_per_line_);
+    }
+    return true;
+}
+
+bool V4L2Capture::requeue() {
+    if (held_ < 0) {
+        return false;
+    }
+
+    v4l2_buffer buf = {};
+    buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    buf.memory = V4L2_MEMORY_MMAP;
+    buf.index = static_cast<uint32_t>(held_);
+    held_ = -1;
+    if (xioctl(fd_, VIDIOC_QBUF, &buf) != 0) {
+        perror("VIDIOC_QBUF");
+        return false;
+    }
+    return true;
+}
+
+bool V4L2Capture::negotiateFormat(int width, int height) {
+    v4l2_format fmt = {};
+    fmt.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    if (xioctl(fd_, VIDIOC_G_FMT, &fmt) != 0) {
+        perror("VIDIOC_G_FMT");
+        return false;
+    }
+    if (width > 0 && height > 0) {
+        fmt.fmt.pix.width = width;
+        fmt.fmt.pix.height = height;
+    }
+    fmt.fmt.pix.field = V4L2_FIELD_NONE;
+
+    // The driver adjusts what it cannot do, so check what we actually got
+    for (uint32_t format : PREFERRED_FORMATS) {
+        fmt.fmt.pix.pixelformat = format;
+        if (xioctl(fd_, VIDIOC_S_FMT, &fmt) == 0 && fmt.fmt.pix.pixelformat == format) {
+            pixel_format_ = format;
+            width_ = fmt.fmt.pix.width;
+            height_ = fmt.fmt.pix.height;
+            bytes_per_line_ = fmt.fmt.pix.bytesperline;
+            if (bytes_per_line_ == 0) {
+                bytes_per_line_ = (format == V4L2_PIX_FMT_YUYV ? 2 : 1) * width_;
+            }
+            return true;
+        }
+    }
+
+    fprintf(stderr, "%s supports none of GREY, NV12 or YUYV\n", device_.c_str());
+    return false;
+}
+
+bool V4L2Capture::mapBuffers() {
+    v4l2_requestbuffers req = {};
+    req.count = buffer_count_;
+    req.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    req.memory = V4L2_MEMORY_MMAP;
+    if (xioctl(fd_, VIDIOC_REQBUFS, &req) != 0 || req.count < 2) {
+        perror("VIDIOC_REQBUFS");
+        return false;
+    }
+
+    for (uint32_t i = 0; i < req.count; i++) {
+        v4l2_buffer buf = {};
+        buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        buf.memory = V4L2_MEMORY_MMAP;
+        buf.index = i;
+        if (xioctl(fd_, VIDIOC_QUERYBUF, &buf) != 0) {
+            perror("VIDIOC_QUERYBUF");
+            return false;
+        }
+
+        void *start = mmap(nullptr, buf.length, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, buf.m.offset);
+        if (start == MAP_FAILED) {
+            perror("Failed to map V4L2 buffer");
+            return false;
+        }
+        buffers_.push_back({start, buf.length});
+
+        if (xioctl(fd_, VIDIOC_QBUF, &buf) != 0) {
+            perror("VIDIOC_QBUF");
+            return false;
+        }
+    }
+
+    return true;
+}
+
+}  // namespace video
+}  // namespace teton
@@ -0,0 +1,70 @@
+#ifndef __TETON_VIDEO_V4L2_CAPTURE_HPP__
+#define __TETON_VIDEO_V4L2_CAPTURE_HPP__
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <opencv2/core.hpp>
+
+#include "frame_source.hpp"
+
+namespace teton {
+namespace video {
+
+// Native V4L2 capture that hands out driver buffers without copying.
+//
+// The driver fills a small ring of mmap'd buffers. read() wraps the newest
+// filled buffer in a cv::Mat header, which stays valid until release() hands
+// the buffer back to the driver. Only the luma plane is exposed for GREY and
+// NV12. YUYV interleaves luma and chroma, so its luma is extracted into a
+// reused buffer and the driver buffer is handed back right away.
+class V4L2Capture : public FrameSource {
+   public:
+    explicit V4L2Capture(const std::string &device, unsigned int bufferCount = 4);
+    ~V4L2Capture();
+
+    bool open(int width = 0, int height = 0);
+    void close();
+    bool isOpened() const;
+
+    // Readable as soon as a filled buffer can be dequeued
+    int fd() const override { return fd_; }
+
+    // Skips to the newest filled buffer, requeueing all older ones
+    bool read(cv::Mat &frame) override;
+    void release() override;
+
+    // Dequeueing failed for another reason than an empty queue
+    bool ended() const override { return failed_; }
+
+    uint32_t pixelFormat() const { return pixel_format_; }
+
+   private:
+    struct Buffer {
+        void *start;
+        size_t length;
+    };
+
+    const std::string device_;
+    const unsigned int buffer_count_;
+    int fd_ = -1;
+    bool streaming_ = false;
+    bool failed_ = false;
+    int width_ = 0;
+    int height_ = 0;
+    size_t bytes_per_line_ = 0;
+    uint32_t pixel_format_ = 0;
+    int held_ = -1;  // index of the buffer currently wrapped in a Mat
+    std::vector<Buffer> buffers_;
+    cv::Mat luma_;
+
+    bool dequeue(cv::Mat &view);
+    bool requeue();
+    bool negotiateFormat(int width, int height);
+    bool mapBuffers();
+};
+
+}  // namespace video
+}  // namespace teton
+
+#endif
@@ -0,0 +1,117 @@
+#include "video_capture_source.hpp"
+
+#include <cctype>
+#include <mutex>
+#include <cstdlib>
+#include <vector>
+#include <algorithm>
+#include <opencv2/core/version.hpp>
+
+namespace teton {
+namespace video {
+
+// The FFmpeg options travel through the environment, which is process wide
+static std::mutex captureOptionsMutex;
+
+VideoCaptureSource::VideoCaptureSource(const std::string &input, const DecoderOptions &decoder) :
+    input_(input),
+    decoder_(decoder) {
+    // empty constructor
+}
+
+static bool isCameraIndex(const std::string &input) {
+    return !input.empty() && std::all_of(input.begin(), input.end(), [](char c) {
+        return std::isdigit(static_cast<unsigned char>(c));
+    });
+}
+
+// OpenCV hands the capture options to the demuxer and only takes avdiscard
+// out of them for the decoder. Setting them replaces OpenCV's own default, so
+// that one is kept as well.
+static std::string captureOptions(const DecoderOptions &decoder) {
+    std::string options = "rtsp_transport;tcp";
+    if (!decoder.skipFrame.empty()) {
+        options += "|avdiscard;" + decoder.skipFrame;
+    }
+    return options;
+}
+
+// Set before other threads run, read-only afterwards
+static bool decoderOptionsExported = false;
+
+void VideoCaptureSource::exportDecoderOptions(const DecoderOptions &decoder) {
+    if (!decoder.skipFrame.empty()) {
+        setenv("OPENCV_FFMPEG_CAPTURE_OPTIONS", captureOptions(decoder).c_str(), 1);
+    }
+    if (decoder.threads > 0) {
+        setenv("OPENCV_FFMPEG_THREADS", std::to_string(decoder.threads).c_str(), 1);
+    }
+    decoderOptionsExported = true;
+}
+
+bool VideoCaptureSource::open() {
+    if (isCameraIndex(input_)) {
+        return cap_.open(std::stoi(input_));
+    }
+    if (decoder_.empty()) {
+        return cap_.open(input_);
+    }
+
+    std::vector<int> params;
+    bool threadsFromEnvironment = false;
+#if CV_VERSION_MAJOR > 4 || (CV_VERSION_MAJOR == 4 && CV_VERSION_MINOR >= 7)
+    // Newer OpenCV sizes the decoder thread pool from this property
+    if (decoder_.threads > 0) {
+        params.push_back(cv::CAP_PROP_N_THREADS);
+        params.push_back(decoder_.threads);
+    }
+#else
+    // Older OpenCV only reads the thread count from the environment
+    threadsFromEnvironment = decoder_.threads > 0;
+#endif
+    if (decoderOptionsExported || (decoder_.skipFrame.empty() && !threadsFromEnvironment)) {
+        return cap_.open(input_, cv::CAP_FFMPEG, params);
+    }
+
+    std::lock_guard<std::mutex> lock(captureOptionsMutex);
+    setenv("OPENCV_FFMPEG_CAPTURE_OPTIONS", captureOptions(decoder_).c_str(), 1);
+    if (threadsFromEnvironment) {
+        setenv("OPENCV_FFMPEG_THREADS", std::to_string(decoder_.threads).c_str(), 1);
+    }
+    bool opened = cap_.open(input_, cv::CAP_FFMPEG, params);
+    unsetenv("OPENCV_FFMPEG_CAPTURE_OPTIONS");
+    if (threadsFromEnvironment) {
+        unsetenv("OPENCV_FFMPEG_THREADS");
+    }
+    return opened;
+}
+
+bool VideoCaptureSource::read(cv::Mat &frame) {
+    return cap_.read(frame) && !frame.empty();
+}
+
+double VideoCaptureSource::fps() const {
+    return cap_.get(cv::CAP_PROP_FPS);
+}
+
+size_t VideoCaptureSource::frameBytes() const {
+    // Decoded frames are converted to BGR
+    return static_cast<size_t>(cap_.get(cv::CAP_PROP_FRAME_WIDTH)) *
+           static_cast<size_t>(cap_.get(cv::CAP_PROP_FRAME_HEIGHT)) * 3;
+}
+
+bool VideoCaptureSource::seek(double seconds) {
+    return cap_.set(cv::CAP_PROP_POS_MSEC, seconds * 1000.0);
+}
+
+double VideoCaptureSource::position() const {
+    return cap_.get(cv::CAP_PROP_POS_MSEC) / 1000.0;
+}
+
+bool VideoCaptureSource::isFile() const {
+    // Network streams such as rtsp:// are live as well
+    return !isCameraIndex(input_) && input_.find("://") == std::string::npos;
+}
+
+}  // namespace video
+}  // namespace teton
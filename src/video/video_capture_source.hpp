@@ -0,0 +1,45 @@
+#ifndef __TETON_VIDEO_VIDEO_CAPTURE_SOURCE_HPP__
+#define __TETON_VIDEO_VIDEO_CAPTURE_SOURCE_HPP__
+
+#include <string>
+#include <opencv2/videoio.hpp>
+
+#include "frame_source.hpp"
+
+namespace teton {
+namespace video {
+
+// Frames decoded by cv::VideoCapture from a file, network stream or camera index
+class VideoCaptureSource : public FrameSource {
+   public:
+    explicit VideoCaptureSource(const std::string &input, const DecoderOptions &decoder = DecoderOptions());
+
+    bool open();
+
+    // Puts the decoder options into the environment, where OpenCV reads
+    // them, for every capture opened afterwards. open() leaves the
+    // environment alone from then on, so sources can be opened from several
+    // threads. Only call this before any other thread is started.
+    static void exportDecoderOptions(const DecoderOptions &decoder);
+    bool read(cv::Mat &frame) override;
+    double fps() const override;
+    size_t frameBytes() const override;
+    bool live() const override { return !isFile(); }
+
+    // Position in the input, only meaningful for files
+    bool seek(double seconds);
+    double position() const;
+
+    // Neither a camera index nor a network stream
+    bool isFile() const;
+
+   private:
+    const std::string input_;
+    const DecoderOptions decoder_;
+    cv::VideoCapture cap_;
+};
+
+}  // namespace video
+}  // namespace teton
+
+#endif
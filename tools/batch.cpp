@@ -0,0 +1,193 @@
+#include <map>
+#include <set>
+#include <mutex>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include "src/analysis/timeline.hpp"
+#include "src/video/video_capture_source.hpp"
+
+// Generated header with information from CMake
+#include "version_config.h"
+
+const char *VIDEO_EXTENSIONS[] = {".mp4", ".mkv", ".avi", ".mov", ".ts", ".h264", ".h265", ".y4m"};
+
+static bool hasVideoExtension(const std::string &name) {
+    for (const char *extension : VIDEO_EXTENSIONS) {
+        std::string suffix(extension);
+        if (name.size() > suffix.size() && name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// A directory is scanned for video files, any other file is read as a
+// manifest with one path per line
+static bool collectInputs(const std::string &input, std::vector<std::string> &paths) {
+    struct stat st;
+    if (stat(input.c_str(), &st) != 0) {
+        perror(("Failed to open " + input).c_str());
+        return false;
+    }
+
+    if (S_ISDIR(st.st_mode)) {
+        DIR *dir = opendir(input.c_str());
+        if (dir == nullptr) {
+            perror(("Failed to open " + input).c_str());
+            return false;
+        }
+        while (dirent *entry = readdir(dir)) {
+            if (hasVideoExtension(entry->d_name)) {
+                paths.push_back(input + "/" + entry->d_name);
+            }
+        }
+        closedir(dir);
+        return true;
+    }
+
+    std::ifstream manifest(input);
+    std::string line;
+    while (std::getline(manifest, line)) {
+        if (!line.empty() && line[0] != '#') {
+            paths.push_back(line);
+        }
+    }
+    return true;
+}
+
+static std::string baseName(const std::string &path) {
+    size_t slash = path.find_last_of('/');
+    std::string name = slash == std::string::npos ? path : path.substr(slash + 1);
+    size_t dot = name.find_last_of('.');
+    return dot == std::string::npos ? name : name.substr(0, dot);
+}
+
+// Recordings sharing a base name, e.g. day1/bed.mp4 and day2/bed.mp4 or
+// bed.mp4 and bed.mkv, are named after their whole path instead, so no
+// worker overwrites another one's output
+static std::vector<std::string> outputNames(const std::vector<std::string> &paths) {
+    std::map<std::string, int> baseCounts;
+    for (const auto &path : paths) {
+        baseCounts[baseName(path)]++;
+    }
+
+    std::vector<std::string> names;
+    std::set<std::string> used;
+    for (size_t i = 0; i < paths.size(); i++) {
+        std::string name = baseName(paths[i]);
+        if (baseCounts[name] > 1) {
+            name = paths[i];
+            size_t start = name.find_first_not_of("./");
+            name = start == std::string::npos ? name : name.substr(start);
+            std::replace(name.begin(), name.end(), '/', '_');
+        }
+        // The same file listed twice in a manifest
+        if (!used.insert(name).second) {
+            name += "-" + std::to_string(i);
+            used.insert(name);
+        }
+        names.push_back(name);
+    }
+    return names;
+}
+
+int main(int argc, char **argv) {
+    printf("******* %s batch v%s %s *******\n", PROJECT_NAME, PROJECT_VERSION, CMAKE_BUILD_TYPE);
+
+    if (argc < 3) {
+        printf("ERROR: Input and output directory not provided...\n");
+        printf("  Usage: %s <directory|manifest> <output_directory> [all|keyframes|stride_seconds] [csv|bin] [jobs]\n", argv[0]);
+        return -1;
+    }
+    std::string outputDir = argv[2];
+
+    teton::analysis::TimelineOptions options;
+    options.mode = teton::analysis::SampleMode::All;
+    if (argc > 3) {
+        std::string sampling = argv[3];
+        if (sampling == "keyframes") {
+            options.mode = teton::analysis::SampleMode::Keyframes;
+        } else if (sampling != "all") {
+            options.mode = teton::analysis::SampleMode::Stride;
+            options.strideSeconds = atof(sampling.c_str());
+            if (options.strideSeconds <= 0.0) {
+                fprintf(stderr, "Stride must be a positive number of seconds\n");
+                return -1;
+            }
+        }
+    }
+    bool binary = argc > 4 && std::string(argv[4]) == "bin";
+    int jobs = argc > 5 ? atoi(argv[5]) : static_cast<int>(std::thread::hardware_concurrency());
+    jobs = std::max(jobs, 1);
+
+    // Files are decoded in parallel instead, one decoder thread each avoids
+    // oversubscription. OpenCV before 4.7 only takes the thread count from
+    // the environment, which workers must not change while others read it.
+    options.decoderThreads = 1;
+    teton::video::VideoCaptureSource::exportDecoderOptions(teton::analysis::decoderOptions(options));
+
+    std::vector<std::string> paths;
+    if (!collectInputs(argv[1], paths)) {
+        return -1;
+    }
+    std::vector<std::string> names = outputNames(paths);
+    printf("Processing %zu recordings with %d workers\n", paths.size(), jobs);
+
+    // Each worker claims the next unprocessed file until none are left
+    std::atomic<size_t> next(0);
+    std::atomic<int> failures(0);
+    std::mutex logMutex;
+    auto worker = [&]() {
+        for (size_t i = next++; i < paths.size(); i = next++) {
+            auto start = std::chrono::steady_clock::now();
+
+            std::vector<teton::analysis::TimelineSample> timeline;
+            if (!teton::analysis::analyzeRecording(paths[i], options, timeline)) {
+                failures++;
+                continue;
+            }
+
+            std::string outputPath = outputDir + "/" + names[i] + (binary ? ".bin" : ".csv");
+            std::ofstream out(outputPath, binary ? std::ios::binary : std::ios::out);
+            if (!out) {
+                fprintf(stderr, "Failed to open %s for writing\n", outputPath.c_str());
+                failures++;
+                continue;
+            }
+            if (binary) {
+                teton::analysis::writeTimelineBinary(out, timeline);
+            } else {
+                teton::analysis::writeTimelineCsv(out, timeline);
+            }
+
+            size_t ledOn = 0;
+            for (const auto &sample : timeline) {
+                ledOn += sample.led ? 1 : 0;
+            }
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            std::lock_guard<std::mutex> lock(logMutex);
+            printf("%s: %zu frames, LED on for %zu, %.1f s\n", paths[i].c_str(), timeline.size(), ledOn, seconds);
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (int i = 0; i < jobs; i++) {
+        workers.push_back(std::thread(worker));
+    }
+    for (auto &t : workers) {
+        t.join();
+    }
+
+    printf("Finished %zu recordings, %d failed\n", paths.size(), failures.load());
+    return failures.load() == 0 ? 0 : -1;
+}
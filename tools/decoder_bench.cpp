@@ -0,0 +1,132 @@
+#include <thread>
+#include <vector>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+
+#include <opencv2/core.hpp>
+
+#include "src/video/frame_source.hpp"
+#include "src/video/video_capture_source.hpp"
+
+// Generated header with information from CMake
+#include "version_config.h"
+
+struct SweepResult {
+    double openMs;
+    double fps;
+    double meanMs;
+    double p99Ms;
+    int frames;
+    double mediaSeconds;  // position reached in the video
+};
+
+// Decodes up to maxFrames frames and measures how long each read takes
+bool runDecoder(const std::string &path, const teton::video::DecoderOptions &decoder, int maxFrames, SweepResult &result) {
+    auto start = std::chrono::steady_clock::now();
+    teton::video::VideoCaptureSource source(path, decoder);
+    if (!source.open()) {
+        return false;
+    }
+    auto opened = std::chrono::steady_clock::now();
+
+    std::vector<double> latencies;
+    latencies.reserve(maxFrames);
+    cv::Mat frame;
+    while (static_cast<int>(latencies.size()) < maxFrames) {
+        auto before = std::chrono::steady_clock::now();
+        if (!source.read(frame)) {
+            break;
+        }
+        latencies.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - before).count());
+    }
+    auto finished = std::chrono::steady_clock::now();
+
+    result.frames = static_cast<int>(latencies.size());
+    result.mediaSeconds = source.position();
+    result.openMs = std::chrono::duration<double, std::milli>(opened - start).count();
+    if (latencies.empty()) {
+        result.fps = result.meanMs = result.p99Ms = 0.0;
+        return true;
+    }
+
+    double decodeSeconds = std::chrono::duration<double>(finished - opened).count();
+    result.fps = latencies.size() / decodeSeconds;
+    result.meanMs = 1000.0 * decodeSeconds / latencies.size();
+    std::sort(latencies.begin(), latencies.end());
+    result.p99Ms = latencies[std::min(latencies.size() - 1, latencies.size() * 99 / 100)];
+    return true;
+}
+
+int main(int argc, char **argv) {
+    printf("******* %s decoder benchmark v%s %s *******\n", PROJECT_NAME, PROJECT_VERSION, CMAKE_BUILD_TYPE);
+
+    if (argc < 2) {
+        printf("ERROR: Path to video file not provided...\n");
+        printf("  Usage: %s <path_to_video_file> [frames_per_run]\n", argv[0]);
+        return -1;
+    }
+    std::string path = argv[1];
+    int maxFrames = argc > 2 ? atoi(argv[2]) : 300;
+
+    // Thread counts from 1 up to the number of cores, plus FFmpeg's own choice
+    std::vector<int> threadCounts = {0};
+    int cores = static_cast<int>(std::thread::hardware_concurrency());
+    for (int threads = 1; threads <= std::max(cores, 1); threads *= 2) {
+        threadCounts.push_back(threads);
+    }
+    if (cores > 1 && threadCounts.back() != cores) {
+        threadCounts.push_back(cores);
+    }
+    std::vector<std::string> skipLevels = {"default", "nonref", "nonkey"};
+
+    // results[thread count][skip level]
+    std::vector<std::vector<SweepResult>> results(threadCounts.size(), std::vector<SweepResult>(skipLevels.size()));
+    printf("%-8s %-8s %9s %9s %9s %9s %7s %9s\n",
+           "threads", "skip", "open_ms", "fps", "mean_ms", "p99_ms", "frames", "media_s");
+    for (size_t t = 0; t < threadCounts.size(); t++) {
+        for (size_t k = 0; k < skipLevels.size(); k++) {
+            teton::video::DecoderOptions decoder;
+            decoder.threads = threadCounts[t];
+            decoder.skipFrame = skipLevels[k];
+
+            SweepResult &result = results[t][k];
+            if (!runDecoder(path, decoder, maxFrames, result)) {
+                fprintf(stderr, "Error opening %s\n", path.c_str());
+                return -1;
+            }
+            printf("%-8s %-8s %9.1f %9.1f %9.2f %9.2f %7d %9.2f\n",
+                   threadCounts[t] == 0 ? "auto" : std::to_string(threadCounts[t]).c_str(), skipLevels[k].c_str(),
+                   result.openMs, result.fps, result.meanMs, result.p99Ms, result.frames, result.mediaSeconds);
+        }
+    }
+
+    // A setting that changes nothing most likely never reached the decoder.
+    // Skip levels show in how many frames a second of video decodes to.
+    auto framesPerMediaSecond = [](const SweepResult &result) {
+        return result.mediaSeconds > 0.0 ? result.frames / result.mediaSeconds : 0.0;
+    };
+    for (size_t t = 0; t < threadCounts.size(); t++) {
+        double reference = framesPerMediaSecond(results[t][0]);
+        for (size_t k = 1; k < skipLevels.size(); k++) {
+            double rate = framesPerMediaSecond(results[t][k]);
+            if (reference > 0.0 && rate > 0.98 * reference) {
+                printf("WARNING: skip %s with %s threads decoded as many frames as default. The decoder ignored it, "
+                       "or the video has no frames it applies to.\n",
+                       skipLevels[k].c_str(), threadCounts[t] == 0 ? "auto" : std::to_string(threadCounts[t]).c_str());
+            }
+        }
+    }
+
+    // Thread counts show in decode speed, compared between 1 thread and the most
+    double single = results[1][0].fps;
+    double most = results.back()[0].fps;
+    if (threadCounts.size() > 2 && single > 0.0 && most < 1.1 * single) {
+        printf("WARNING: %d threads decoded at %.1f fps against %.1f fps for 1 thread. The thread count may not "
+               "reach the decoder, or the codec does not decode in parallel.\n",
+               threadCounts.back(), most, single);
+    }
+
+    return 0;
+}
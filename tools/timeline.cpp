@@ -0,0 +1,52 @@
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+
+#include "src/analysis/timeline.hpp"
+
+// Generated header with information from CMake
+#include "version_config.h"
+
+int main(int argc, char **argv) {
+    printf("******* %s timeline v%s %s *******\n", PROJECT_NAME, PROJECT_VERSION, CMAKE_BUILD_TYPE);
+
+    if (argc < 2) {
+        printf("ERROR: Path to video file not provided...\n");
+        printf("  Usage: %s <path_to_video_file> [keyframes|stride_seconds] [output.csv]\n", argv[0]);
+        return -1;
+    }
+
+    teton::analysis::TimelineOptions options;
+    if (argc > 2) {
+        std::string sampling = argv[2];
+        if (sampling == "keyframes") {
+            options.mode = teton::analysis::SampleMode::Keyframes;
+        } else {
+            options.strideSeconds = atof(sampling.c_str());
+            if (options.strideSeconds <= 0.0) {
+                fprintf(stderr, "Stride must be a positive number of seconds\n");
+                return -1;
+            }
+        }
+    }
+
+    std::vector<teton::analysis::TimelineSample> timeline;
+    if (!teton::analysis::analyzeRecording(argv[1], options, timeline)) {
+        return -1;
+    }
+
+    if (argc > 3) {
+        std::ofstream out(argv[3]);
+        if (!out) {
+            fprintf(stderr, "Failed to open %s for writing\n", argv[3]);
+            return -1;
+        }
+        teton::analysis::writeTimelineCsv(out, timeline);
+    } else {
+        teton::analysis::writeTimelineCsv(std::cout, timeline);
+    }
+
+    fprintf(stderr, "Evaluated %zu frames\n", timeline.size());
+    return 0;
+}